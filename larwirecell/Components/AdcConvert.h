@@ -0,0 +1,185 @@
+/** Conversion of short int ADC samples to float charge.
+ *
+ * This is the inner loop of ingesting raw::RawDigit into WCT and it
+ * is memory bound.  The widen, convert and baseline-pad steps are
+ * done in a single pass with explicit AVX-512 or AVX2 code chosen at
+ * run time according to what the CPU supports, else a scalar loop.
+ *
+ * Header only so it may be shared by the WCT components and the art
+ * modules without a link dependency.
+ */
+
+#ifndef LARWIRECELL_COMPONENTS_ADCCONVERT
+#define LARWIRECELL_COMPONENTS_ADCCONVERT
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define WCLS_ADCCONVERT_X86 1
+#include <immintrin.h>
+#endif
+
+namespace wcls {
+  namespace adc {
+
+    /// Signature of a conversion kernel.  The first min(nin, nout)
+    /// elements of out are set from in and any remaining are set to
+    /// pad.
+    typedef void (*convert_t)(const short* in, size_t nin, float* out, size_t nout, float pad);
+
+    inline void convert_scalar(const short* in, size_t nin, float* out, size_t nout, float pad)
+    {
+      const size_t n = std::min(nin, nout);
+      for (size_t ind = 0; ind < n; ++ind) {
+        out[ind] = in[ind];
+      }
+      std::fill(out + n, out + nout, pad);
+    }
+
+#ifdef WCLS_ADCCONVERT_X86
+    __attribute__((target("avx2"))) inline void convert_avx2(const short* in,
+                                                             size_t nin,
+                                                             float* out,
+                                                             size_t nout,
+                                                             float pad)
+    {
+      const size_t n = std::min(nin, nout);
+      size_t ind = 0;
+      for (; ind + 16 <= n; ind += 16) {
+        const __m256i s16 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + ind));
+        const __m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(s16));
+        const __m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(s16, 1));
+        _mm256_storeu_ps(out + ind, _mm256_cvtepi32_ps(lo));
+        _mm256_storeu_ps(out + ind + 8, _mm256_cvtepi32_ps(hi));
+      }
+      for (; ind < n; ++ind) {
+        out[ind] = in[ind];
+      }
+      const __m256 vpad = _mm256_set1_ps(pad);
+      for (; ind + 8 <= nout; ind += 8) {
+        _mm256_storeu_ps(out + ind, vpad);
+      }
+      for (; ind < nout; ++ind) {
+        out[ind] = pad;
+      }
+    }
+
+    // The zero-masked forms avoid a spurious -Wmaybe-uninitialized
+    // from the unmasked intrinsics in some GCC versions.
+    __attribute__((target("avx512f"))) inline __m512 widen512(__m256i s16)
+    {
+      return _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_maskz_cvtepi16_epi32(0xFFFF, s16));
+    }
+
+    __attribute__((target("avx512f"))) inline void convert_avx512(const short* in,
+                                                                  size_t nin,
+                                                                  float* out,
+                                                                  size_t nout,
+                                                                  float pad)
+    {
+      const size_t n = std::min(nin, nout);
+      size_t ind = 0;
+      for (; ind + 32 <= n; ind += 32) {
+        const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + ind));
+        const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + ind + 16));
+        _mm512_storeu_ps(out + ind, widen512(lo));
+        _mm512_storeu_ps(out + ind + 16, widen512(hi));
+      }
+      if (ind + 16 <= n) {
+        const __m256i s16 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + ind));
+        _mm512_storeu_ps(out + ind, widen512(s16));
+        ind += 16;
+      }
+      for (; ind < n; ++ind) {
+        out[ind] = in[ind];
+      }
+      const __m512 vpad = _mm512_set1_ps(pad);
+      for (; ind + 16 <= nout; ind += 16) {
+        _mm512_storeu_ps(out + ind, vpad);
+      }
+      for (; ind < nout; ++ind) {
+        out[ind] = pad;
+      }
+    }
+#endif
+
+    /// Summary statistics of a run of ADC samples.
+    struct Stats {
+      float baseline{0}; // most frequent value, ties go to the lower
+      float rms{0};      // about the mean
+      short min{0}, max{0};
+      int nsat{0}; // samples at or above saturation
+    };
+
+    /// Convert as convert_scalar() while also filling the statistics
+    /// of the converted samples.  A histogram gives the most frequent
+    /// value in the same pass, so this is not vectorized.
+    inline Stats convert_stats(const short* in,
+                               size_t nin,
+                               float* out,
+                               size_t nout,
+                               float pad,
+                               short saturation)
+    {
+      Stats st;
+      const size_t n = std::min(nin, nout);
+      std::fill(out + n, out + nout, pad);
+      if (!n) { return st; }
+
+      thread_local std::vector<uint32_t> hist(1 << 16, 0);
+      short lo = in[0], hi = in[0];
+      double sum = 0, sum2 = 0;
+      for (size_t ind = 0; ind < n; ++ind) {
+        const short adc = in[ind];
+        out[ind] = adc;
+        ++hist[uint16_t(adc)];
+        lo = std::min(lo, adc);
+        hi = std::max(hi, adc);
+        sum += adc;
+        sum2 += double(adc) * adc;
+        st.nsat += adc >= saturation;
+      }
+
+      // Scan and clear only the touched part of the histogram.
+      uint32_t most = 0;
+      for (int adc = lo; adc <= hi; ++adc) {
+        uint32_t& count = hist[uint16_t(adc)];
+        if (count > most) {
+          most = count;
+          st.baseline = adc;
+        }
+        count = 0;
+      }
+      const double mean = sum / n;
+      st.rms = std::sqrt(std::max(0.0, sum2 / n - mean * mean));
+      st.min = lo;
+      st.max = hi;
+      return st;
+    }
+
+    /// Return the best kernel for this CPU.
+    inline convert_t select()
+    {
+#ifdef WCLS_ADCCONVERT_X86
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f")) { return convert_avx512; }
+      if (__builtin_cpu_supports("avx2")) { return convert_avx2; }
+#endif
+      return convert_scalar;
+    }
+
+    /// Convert with the best kernel for this CPU.
+    inline void convert(const short* in, size_t nin, float* out, size_t nout, float pad = 0)
+    {
+      static const convert_t kernel = select();
+      kernel(in, nin, out, nout, pad);
+    }
+
+  }
+}
+
+#endif
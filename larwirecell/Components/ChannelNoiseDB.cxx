@@ -53,6 +53,24 @@ wcls::ChannelNoiseDB::ChannelNoiseDB()
 wcls::ChannelNoiseDB::~ChannelNoiseDB() {}
 
 void wcls::ChannelNoiseDB::visit(art::Event& event)
+{
+  if (!m_refreshed) {
+    refresh();
+    m_refreshed = true;
+  }
+}
+
+void wcls::ChannelNoiseDB::beginRun(art::Run const& run)
+{
+  m_refreshed = false;
+}
+
+void wcls::ChannelNoiseDB::endRun(art::Run const& run)
+{
+  m_refreshed = false;
+}
+
+void wcls::ChannelNoiseDB::refresh()
 {
   if ((!m_bad_channel_policy) && (!m_misconfig_channel_policy)) {
     return; // no override
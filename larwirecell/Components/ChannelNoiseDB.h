@@ -13,10 +13,13 @@ namespace wcls {
 
     /// IArtEventVisitor.
     //
-    // Note: we don't actually poke at the event but use this
-    // entry to refresh info from services in case they change
-    // event-to-event.
+    // Note: we don't actually poke at the event.  A new run only
+    // marks the info from services stale.  The first visit of the
+    // run refreshes it as by then the channel status and
+    // calibration providers have updated their IOV timestamp.
     virtual void visit(art::Event& event);
+    virtual void beginRun(art::Run const& run);
+    virtual void endRun(art::Run const& run);
 
     /// IConfigurable.
     //
@@ -38,6 +41,10 @@ namespace wcls {
 
     OverridePolicy_t parse_policy(const WireCell::Configuration& jpol);
 
+    // Query services and apply the override policies.
+    void refresh();
+    bool m_refreshed{false};
+
     OverridePolicy_t m_bad_channel_policy;
     OverridePolicy_t m_misconfig_channel_policy;
     double m_fgstgs[4];
@@ -23,7 +23,25 @@ wcls::ChannelSelectorDB::~ChannelSelectorDB() {}
 
 void wcls::ChannelSelectorDB::visit(art::Event& event)
 {
-  std::cerr << "ChannelSelectorDB art::Event visit!\n";
+  if (!m_refreshed) {
+    refresh();
+    m_refreshed = true;
+  }
+}
+
+void wcls::ChannelSelectorDB::beginRun(art::Run const& run)
+{
+  m_refreshed = false;
+}
+
+void wcls::ChannelSelectorDB::endRun(art::Run const& run)
+{
+  m_refreshed = false;
+}
+
+void wcls::ChannelSelectorDB::refresh()
+{
+  std::cerr << "ChannelSelectorDB refreshing " << m_type << " channels\n";
 
   // FIXME: the current assumption in this code is that LS channel
   // numbers are identified with WCT channel IDs.  For MicroBooNE
@@ -32,6 +50,7 @@ void wcls::ChannelSelectorDB::visit(art::Event& event)
   auto nchans = gc.Nchannels();
 
   if (m_type == "bad") {
+    m_bad_channels.clear();
     auto const& csvc = art::ServiceHandle<lariov::ChannelStatusService const>()->GetProvider();
 
     for (size_t ich = 0; ich < nchans; ++ich) {
@@ -42,7 +61,7 @@ void wcls::ChannelSelectorDB::visit(art::Event& event)
   if (m_type == "misconfigured") {
     const auto& esvc = art::ServiceHandle<lariov::ElectronicsCalibService const>()->GetProvider();
 
-    std::vector<int> mc_channels;
+    m_miscfg_channels.clear();
     for (size_t ich = 0; ich < nchans; ++ich) {
       if (esvc.ExtraInfo(ich).GetBoolData("is_misconfigured")) { m_miscfg_channels.push_back(ich); }
     }
@@ -12,10 +12,12 @@ namespace wcls {
     virtual ~ChannelSelectorDB();
 
     /// IArtEventVisitor.
-    // Note: we don't actually poke at the event but use this
-    // entry to refresh info from services in case they change
-    // event-to-event.
+    // Note: we don't actually poke at the event.  Info from
+    // services is refreshed by the first visit of each run, once
+    // database backed services have the run's timestamp.
     virtual void visit(art::Event& event);
+    virtual void beginRun(art::Run const& run);
+    virtual void endRun(art::Run const& run);
 
     /// IConfigurable.
     virtual void configure(const WireCell::Configuration& config);
@@ -24,6 +26,9 @@ namespace wcls {
     virtual channel_group_t miscfg_channels() const { return m_miscfg_channels; }
 
   private:
+    void refresh();
+    bool m_refreshed{false};
+
     std::string m_type;
     channel_group_t m_bad_channels;
     channel_group_t m_miscfg_channels;
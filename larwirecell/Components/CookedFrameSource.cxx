@@ -1,4 +1,5 @@
 #include "CookedFrameSource.h"
+#include "WaveformPool.h"
 #include "art/Framework/Principal/Handle.h"
 
 #include "art/Framework/Principal/Event.h"
@@ -8,9 +9,11 @@
 #include "TTimeStamp.h"
 
 #include "WireCellAux/SimpleFrame.h"
-#include "WireCellAux/SimpleTrace.h"
 #include "WireCellUtil/NamedFactory.h"
 
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
 WIRECELL_FACTORY(wclsCookedFrameSource,
                  wcls::CookedFrameSource,
                  wcls::IArtEventVisitor,
@@ -19,7 +22,6 @@ WIRECELL_FACTORY(wclsCookedFrameSource,
 using namespace wcls;
 using namespace WireCell;
 using WireCell::Aux::SimpleFrame;
-using WireCell::Aux::SimpleTrace;
 
 CookedFrameSource::CookedFrameSource() : m_nticks(0) {}
 
@@ -32,6 +34,19 @@ WireCell::Configuration CookedFrameSource::default_configuration() const
   cfg["tick"] = 0.5 * WireCell::units::us;
   cfg["frame_tags"][0] = "orig"; // the tags to apply to this frame
   cfg["nticks"] = m_nticks;      // if nonzero, truncate or zero-pad frame to this number of ticks.
+  // If true, make one trace per region of interest instead of one
+  // dense trace per channel.  ROIs with no more than merge_gap ticks
+  // between them are merged into one trace.
+  cfg["sparse"] = m_sparse;
+  cfg["merge_gap"] = m_merge_gap;
+  // If true, build traces over channels in parallel with TBB using
+  // blocks of grain_size channels.
+  cfg["parallel"] = m_parallel;
+  cfg["grain_size"] = m_grain_size;
+  // If true, recycle waveform buffers of released frames, keeping
+  // at most buffer_pool_mb MB of them idle (zero for no limit).
+  cfg["buffer_pool"] = false;
+  cfg["buffer_pool_mb"] = 1024;
   return cfg;
 }
 
@@ -48,6 +63,15 @@ void CookedFrameSource::configure(const WireCell::Configuration& cfg)
     m_frame_tags.push_back(jtag.asString());
   }
   m_nticks = get(cfg, "nticks", m_nticks);
+  m_sparse = get(cfg, "sparse", m_sparse);
+  m_merge_gap = std::max(0, get(cfg, "merge_gap", m_merge_gap));
+  m_parallel = get(cfg, "parallel", m_parallel);
+  m_grain_size = std::max(1, get(cfg, "grain_size", m_grain_size));
+  m_pool.reset();
+  if (get(cfg, "buffer_pool", false)) {
+    const size_t max_mb = std::max(0, get(cfg, "buffer_pool_mb", 1024));
+    m_pool = std::make_shared<WaveformPool>(max_mb << 20);
+  }
 }
 
 // this code assumes that the high part of timestamp represents number of seconds from Jan 1st, 1970 and the low part
@@ -59,29 +83,65 @@ static double tdiff(const art::Timestamp& ts1, const art::Timestamp& ts2)
   return tts2.AsDouble() - tts1.AsDouble();
 }
 
-static SimpleTrace* make_trace(const recob::Wire& rw, unsigned int nticks_want)
+// Copy the ROIs of the wire which fall before nticks into the
+// zero-initialized dense trace.  This avoids the temporary dense
+// vector that recob::Wire::Signal() would make.
+static ITrace::pointer make_trace(const recob::Wire& rw,
+                                 unsigned int nticks_want,
+                                 const std::shared_ptr<WaveformPool>& pool)
 {
-  // uint
-  const raw::ChannelID_t chid = rw.Channel();
-  const int tbin = 0;
-  const std::vector<float> sig = rw.Signal();
-
-  const float baseline = 0.0;
-  unsigned int nsamp = sig.size();
-  if (nticks_want > 0) { nsamp = std::min(nsamp, nticks_want); }
-  else {
-    nticks_want = nsamp;
+  if (!nticks_want) { nticks_want = rw.NSignal(); }
+
+  auto trace = std::make_shared<PooledTrace>(pool, rw.Channel(), 0, nticks_want);
+  auto& q = trace->charge();
+  std::fill(q.begin(), q.end(), 0.0);
+  for (auto const& roi : rw.SignalROI().get_ranges()) {
+    const size_t beg = roi.begin_index();
+    const size_t end = std::min<size_t>(roi.end_index(), nticks_want);
+    if (beg >= end) { break; }
+    std::copy(roi.begin(), roi.begin() + (end - beg), q.begin() + beg);
   }
+  return trace;
+}
 
-  auto strace = new SimpleTrace(chid, tbin, nticks_want);
-  auto& q = strace->charge();
-  for (unsigned int itick = 0; itick < nsamp; ++itick) {
-    q[itick] = sig[itick];
-  }
-  for (unsigned int itick = nsamp; itick < nticks_want; ++itick) {
-    q[itick] = baseline;
+// Append one trace per ROI of the wire to traces, with tbin set to
+// the ROI start.  ROIs separated by no more than merge_gap ticks are
+// joined into one trace with the gap zero-filled.  If nticks_want is
+// nonzero, ROIs are clipped to it.
+static void make_sparse_traces(const recob::Wire& rw,
+                               unsigned int nticks_want,
+                               size_t merge_gap,
+                               const std::shared_ptr<WaveformPool>& pool,
+                               ITrace::vector& traces)
+{
+  const int chid = rw.Channel();
+  std::shared_ptr<PooledTrace> strace;
+  size_t tbeg = 0, tend = 0; // tick span of strace
+  for (auto const& roi : rw.SignalROI().get_ranges()) {
+    const size_t beg = roi.begin_index();
+    size_t end = roi.end_index();
+    if (nticks_want) { end = std::min<size_t>(end, nticks_want); }
+    if (beg >= end) { break; }
+
+    if (strace and beg <= tend + merge_gap) {
+      auto& q = strace->charge();
+      q.resize(end - tbeg, 0.0);
+      std::copy(roi.begin(), roi.begin() + (end - beg), q.begin() + (beg - tbeg));
+    }
+    else {
+      if (strace) { traces.push_back(strace); }
+      strace = std::make_shared<PooledTrace>(pool, chid, beg, end - beg);
+      std::copy(roi.begin(), roi.begin() + (end - beg), strace->charge().begin());
+      tbeg = beg;
+    }
+    tend = end;
   }
-  return strace;
+  if (strace) { traces.push_back(strace); }
+}
+
+void CookedFrameSource::consumes(art::ConsumesCollector& collector)
+{
+  m_token = collector.consumes<std::vector<recob::Wire>>(m_inputTag);
 }
 
 void CookedFrameSource::visit(art::Event& e)
@@ -90,7 +150,7 @@ void CookedFrameSource::visit(art::Event& e)
   // fixme: want to avoid depending on DetectorPropertiesService for now.
   const double tick = m_tick;
   art::Handle<std::vector<recob::Wire>> rwvh;
-  bool okay = event.getByLabel(m_inputTag, rwvh);
+  bool okay = m_token ? event.getByToken(*m_token, rwvh) : event.getByLabel(m_inputTag, rwvh);
   if (!okay) {
     std::string msg =
       "WireCell::CookedFrameSource failed to get vector<recob::Wire>: " + m_inputTag.encode();
@@ -104,18 +164,35 @@ void CookedFrameSource::visit(art::Event& e)
   const size_t nchannels = rwv.size();
   std::cerr << "CookedFrameSource: got " << nchannels << " recob::Wire objects\n";
 
-  WireCell::ITrace::vector traces(nchannels);
-  for (size_t ind = 0; ind < nchannels; ++ind) {
-    auto const& rw = rwv.at(ind);
-    traces[ind] = ITrace::pointer(make_trace(rw, m_nticks));
-    if (!ind) { // first time through
-      if (m_nticks) {
-        std::cerr << "\tinput nticks=" << rw.NSignal() << " setting to " << m_nticks << std::endl;
+  if (m_nticks) {
+    std::cerr << "\tinput nticks=" << rwv.front().NSignal() << " setting to " << m_nticks
+              << std::endl;
+  }
+  else {
+    std::cerr << "\tinput nticks=" << rwv.front().NSignal() << " keeping as is" << std::endl;
+  }
+
+  // Each channel fills its own slot so the order is that of the input.
+  WireCell::ITrace::vector traces(m_sparse ? 0 : nchannels);
+  std::vector<WireCell::ITrace::vector> roi_traces(m_sparse ? nchannels : 0);
+  auto build = [&](const tbb::blocked_range<size_t>& range) {
+    for (size_t ind = range.begin(); ind != range.end(); ++ind) {
+      if (m_sparse) {
+        make_sparse_traces(rwv[ind], m_nticks, m_merge_gap, m_pool, roi_traces[ind]);
       }
       else {
-        std::cerr << "\tinput nticks=" << rw.NSignal() << " keeping as is" << std::endl;
+        traces[ind] = make_trace(rwv[ind], m_nticks, m_pool);
       }
     }
+  };
+  if (m_parallel) {
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, nchannels, m_grain_size), build);
+  }
+  else {
+    build(tbb::blocked_range<size_t>(0, nchannels));
+  }
+  for (auto& chtraces : roi_traces) {
+    traces.insert(traces.end(), chtraces.begin(), chtraces.end());
   }
 
   const double time = tdiff(event.getRun().beginTime(), event.time());
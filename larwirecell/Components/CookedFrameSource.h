@@ -13,13 +13,19 @@
 #include "WireCellUtil/Logging.h"
 #include "larwirecell/Interfaces/IArtEventVisitor.h"
 
+#include "art/Framework/Core/ConsumesCollector.h"
 #include "canvas/Utilities/InputTag.h"
+#include "lardataobj/RecoBase/Wire.h"
 
 #include <deque>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
 namespace wcls {
+  class WaveformPool;
+
   class CookedFrameSource : public IArtEventVisitor,
                             public WireCell::IFrameSource,
                             public WireCell::IConfigurable {
@@ -28,6 +34,7 @@ namespace wcls {
     virtual ~CookedFrameSource();
 
     /// IArtEventVisitor
+    virtual void consumes(art::ConsumesCollector& collector);
     virtual void visit(art::Event& event);
 
     /// IFrameSource
@@ -40,8 +47,14 @@ namespace wcls {
   private:
     std::deque<WireCell::IFrame::pointer> m_frames;
     art::InputTag m_inputTag;
+    std::optional<art::ProductToken<std::vector<recob::Wire>>> m_token;
     double m_tick;
     int m_nticks;
+    bool m_sparse{false};
+    int m_merge_gap{0};
+    bool m_parallel{false};
+    int m_grain_size{64};
+    std::shared_ptr<WaveformPool> m_pool;
     std::vector<std::string> m_frame_tags;
     art::InputTag m_wiener_inputTag;
     art::InputTag m_gauss_inputTag;
@@ -0,0 +1,42 @@
+#include "CropWindow.h"
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "lardata/DetectorInfoServices/DetectorClocksService.h"
+#include "lardataalg/DetectorInfo/DetectorClocksData.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace wcls;
+
+void CropWindow::default_configuration(WireCell::Configuration& cfg) const
+{
+  // If crop_nticks is nonzero, keep only crop_nticks ticks starting
+  // at crop_start.  If crop_from_trigger is true, crop_start is
+  // relative to the trigger tick of each event.  Traces keep their
+  // place in the readout by way of their tbin.
+  cfg["crop_start"] = m_start;
+  cfg["crop_nticks"] = m_nticks;
+  cfg["crop_from_trigger"] = m_from_trigger;
+}
+
+void CropWindow::configure(const WireCell::Configuration& cfg)
+{
+  m_start = WireCell::get(cfg, "crop_start", m_start);
+  m_nticks = std::max(0, WireCell::get(cfg, "crop_nticks", m_nticks));
+  m_from_trigger = WireCell::get(cfg, "crop_from_trigger", m_from_trigger);
+}
+
+std::pair<size_t, size_t> CropWindow::range(const art::Event& event) const
+{
+  if (!enabled()) { return std::make_pair(0, std::numeric_limits<size_t>::max()); }
+  int start = m_start;
+  if (m_from_trigger) {
+    auto const clock_data =
+      art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(event);
+    start += detinfo::trigger_offset(clock_data);
+  }
+  const size_t tbeg = std::max(0, start);
+  return std::make_pair(tbeg, tbeg + m_nticks);
+}
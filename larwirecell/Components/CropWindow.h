@@ -0,0 +1,43 @@
+/** A window of ticks to which frame sources may crop the readout.
+ *
+ * The window starts at a fixed tick or at a tick offset from the
+ * trigger as given by the DetectorClocksService, and spans a fixed
+ * number of ticks.  Only samples in the window need be converted.
+ */
+
+#ifndef LARWIRECELL_COMPONENTS_CROPWINDOW
+#define LARWIRECELL_COMPONENTS_CROPWINDOW
+
+#include "WireCellUtil/Configuration.h"
+
+#include <cstddef>
+#include <utility>
+
+namespace art {
+  class Event;
+}
+
+namespace wcls {
+
+  class CropWindow {
+  public:
+    /// Add the crop parameters to a component configuration.
+    void default_configuration(WireCell::Configuration& cfg) const;
+    void configure(const WireCell::Configuration& cfg);
+
+    /// True if cropping is configured.
+    bool enabled() const { return m_nticks > 0; }
+
+    /// The [begin, end) ticks for the event.  If not enabled, this
+    /// is all ticks.
+    std::pair<size_t, size_t> range(const art::Event& event) const;
+
+  private:
+    int m_start{0};
+    int m_nticks{0};
+    bool m_from_trigger{false};
+  };
+
+}
+
+#endif
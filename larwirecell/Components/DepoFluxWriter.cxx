@@ -28,10 +28,16 @@ using namespace WireCell;
 
 void DepoFluxWriter::produces(art::ProducesCollector& collector)
 {
-  // fixme: need to extend WireCell_toolkit module to for consumes().
   collector.produces<std::vector<sim::SimChannel>>(m_simchan_label);
 }
 
+void DepoFluxWriter::consumes(art::ConsumesCollector& collector)
+{
+  if (not m_sed_label.empty()) {
+    m_sed_token = collector.consumes<std::vector<sim::SimEnergyDeposit>>(m_sed_label);
+  }
+}
+
 WireCell::Configuration DepoFluxWriter::default_configuration() const
 {
   Configuration cfg;
@@ -156,7 +162,8 @@ void DepoFluxWriter::visit(art::Event& event)
 {
   art::Handle<std::vector<sim::SimEnergyDeposit>> sedvh;
   if (not m_sed_label.empty()) {
-    bool okay = event.getByLabel(m_sed_label, sedvh);
+    bool okay =
+      m_sed_token ? event.getByToken(*m_sed_token, sedvh) : event.getByLabel(m_sed_label, sedvh);
     if (!okay) {
       std::string msg =
         "DepoFluxWriter failed to get sim::SimEnergyDeposit from art label: " + m_sed_label;
@@ -1,6 +1,7 @@
 #ifndef LARWIRECELL_COMPONENTS_DEPOFLUXWRITER
 #define LARWIRECELL_COMPONENTS_DEPOFLUXWRITER
 
+#include "art/Framework/Core/ConsumesCollector.h"
 #include "canvas/Utilities/InputTag.h"
 #include "larwirecell/Interfaces/IArtEventVisitor.h"
 
@@ -9,6 +10,13 @@
 #include "WireCellIface/IDepoSetFilter.h"
 #include "WireCellUtil/Binning.h"
 
+#include <optional>
+#include <vector>
+
+namespace sim {
+  class SimEnergyDeposit;
+}
+
 namespace wcls {
 
   class DepoFluxWriter : public IArtEventVisitor,
@@ -17,6 +25,7 @@ namespace wcls {
   public:
     /// IArtEventVisitor
     virtual void produces(art::ProducesCollector& collector);
+    virtual void consumes(art::ConsumesCollector& collector);
     virtual void visit(art::Event& event);
 
     /// IDepoSetFilter
@@ -87,6 +96,7 @@ namespace wcls {
     // the IDepo::id() is set directly as the IDE trackID and no
     // origTrackID is set.
     std::string m_sed_label;
+    std::optional<art::ProductToken<std::vector<sim::SimEnergyDeposit>>> m_sed_token;
 
     std::string m_debug_file{""};
 
@@ -20,15 +20,21 @@
 #include "larevt/CalibrationDBI/Interface/DetPedestalProvider.h"
 #include "larevt/CalibrationDBI/Interface/DetPedestalService.h"
 
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <map>
+#include <numeric>
 
 WIRECELL_FACTORY(wclsFrameSaver, wcls::FrameSaver, wcls::IArtEventVisitor, WireCell::IFrameFilter)
 
 using namespace wcls;
 using namespace WireCell;
 
-FrameSaver::FrameSaver() : m_frame(nullptr), m_nticks(0) {}
+FrameSaver::FrameSaver() : m_nticks(0) {}
 
 FrameSaver::~FrameSaver() {}
 
@@ -46,6 +52,19 @@ WireCell::Configuration FrameSaver::default_configuration() const
   // the input IFrame itself is sparse or not.
   cfg["sparse"] = true;
 
+  // How ROIs are selected when sparse.  The defaults keep every run
+  // of nonzero samples.  A sample seeds an ROI if its scaled
+  // magnitude is above threshold and above rel_threshold times the
+  // peak of its waveform.  Runs shorter than min_length ticks are
+  // dropped, the rest are padded by pad_pre and pad_post ticks and
+  // ROIs closer than merge_gap ticks are merged.
+  cfg["sparsify"]["threshold"] = 0.0;
+  cfg["sparsify"]["rel_threshold"] = 0.0;
+  cfg["sparsify"]["min_length"] = 1;
+  cfg["sparsify"]["pad_pre"] = 0;
+  cfg["sparsify"]["pad_post"] = 0;
+  cfg["sparsify"]["merge_gap"] = 0;
+
   // if FALSE (DEFAULT BEHAVIOUR) continue saving RawDigit frame
   // if true, save an empty frame (RawDigit), used for saving CMM only
   cfg["skip_frame"] = false;
@@ -94,6 +113,25 @@ WireCell::Configuration FrameSaver::default_configuration() const
   // Names of channel mask maps to save, if any.
   cfg["chanmaskmaps"] = Json::arrayValue;
 
+  // If true, all frames seen between events are taken to be time
+  // slices of one readout (eg from a slicing wclsRawFrameSource)
+  // and are stitched as they arrive, each keeping the ticks up to
+  // the middle of its overlap with its neighbors.  A slice is
+  // released once the next of its stream arrives so the slices of
+  // a stream must arrive in time order.  Slices of differing frame
+  // ident or "anode<ident>" frame tag are of different streams and
+  // are not stitched together.  Any nticks applies to the stitched
+  // waveforms.  Else
+  // all frames are saved together at their tick offsets from the
+  // earliest and where they overlap the later frame wins.
+  cfg["stitch"] = false;
+
+  // If true, fill the output of the frame tags, and of the channels
+  // of each tag in blocks of grain_size, in parallel with TBB.  The
+  // output is the same as when serial.
+  cfg["parallel"] = m_parallel;
+  cfg["grain_size"] = m_grain_size;
+
   return cfg;
 }
 
@@ -113,6 +151,7 @@ void FrameSaver::configure(const WireCell::Configuration& cfg)
   if (anode_tn.empty()) { THROW(ValueError() << errmsg{"FrameSaver requires an anode plane"}); }
 
   WireCell::IAnodePlane::pointer anode = Factory::find_tn<IAnodePlane>(anode_tn);
+  std::map<int, geo::View_t> chview; // ordered
   for (auto chid : anode->channels()) {
 
     auto wpid = anode->resolve(chid);
@@ -127,12 +166,37 @@ void FrameSaver::configure(const WireCell::Configuration& cfg)
     std::string wct_layer = std::to_string((int)wpid.layer());
     view = (geo::View_t)(cfg["plane_map"][wct_layer].asInt());
 
-    m_chview[chid] = view;
+    chview[chid] = view;
+  }
+
+  m_channels.clear();
+  m_views.clear();
+  for (const auto& [chid, view] : chview) {
+    m_channels.push_back(chid);
+    m_views.push_back(view);
+  }
+  m_chslot.clear();
+  if (!m_channels.empty()) {
+    m_chmin = m_channels.front();
+    m_chslot.assign(m_channels.back() - m_chmin + 1, -1);
+    for (size_t ind = 0; ind < m_channels.size(); ++ind) {
+      m_chslot[m_channels[ind] - m_chmin] = ind;
+    }
   }
 
   m_digitize = get(cfg, "digitize", false);
   m_sparse = get(cfg, "sparse", true);
+  auto jsp = cfg["sparsify"];
+  m_sparsify.threshold = get(jsp, "threshold", 0.0);
+  m_sparsify.rel_threshold = get(jsp, "rel_threshold", 0.0);
+  m_sparsify.min_length = std::max(1, get(jsp, "min_length", 1));
+  m_sparsify.pad_pre = std::max(0, get(jsp, "pad_pre", 0));
+  m_sparsify.pad_post = std::max(0, get(jsp, "pad_post", 0));
+  m_sparsify.merge_gap = std::max(0, get(jsp, "merge_gap", 0));
   m_skipframe = get(cfg, "skip_frame", false);
+  m_stitch = get(cfg, "stitch", false);
+  m_parallel = get(cfg, "parallel", m_parallel);
+  m_grain_size = std::max(1, get(cfg, "grain_size", m_grain_size));
 
   m_cmms = cfg["chanmaskmaps"];
 
@@ -192,6 +256,7 @@ void FrameSaver::configure(const WireCell::Configuration& cfg)
       }
     }
   }
+  reset_output();
 }
 
 void FrameSaver::produces(art::ProducesCollector& collector)
@@ -219,41 +284,203 @@ void FrameSaver::produces(art::ProducesCollector& collector)
   }
 }
 
-static void tagged_traces(IFrame::pointer frame, std::string tag, ITrace::vector& ret)
+// Return the output slot of the channel or -1 if not saved.
+int FrameSaver::slot(int chid) const
+{
+  const long ind = long(chid) - m_chmin;
+  if (ind < 0 || ind >= long(m_chslot.size())) { return -1; }
+  return m_chslot[ind];
+}
+
+// Select the traces of all frames with the tag and group them by
+// slot with a counting sort.  On return, group.traces holds the
+// tagged traces frame by frame and group.frames the index of the
+// frame of each.  If summary, only traces with a summary value
+// for the tag are selected and group.values holds their values.  The
+// traces of slot s are group.traces[group.order[ind]] for
+// group.offsets[s] <= ind < group.offsets[s+1], in frame order.
+// Traces of channels which are not saved are ignored.
+void FrameSaver::group_traces(const std::string& tag, Grouping& group, bool summary) const
 {
-  auto const& all_traces = frame->traces();
-  const auto& ttinds = frame->tagged_traces(tag);
-  if (ttinds.size()) {
-    for (size_t index : ttinds) {
-      ret.push_back(all_traces->at(index));
+  group.traces.clear();
+  group.frames.clear();
+  group.values.clear();
+  for (size_t iframe = 0; iframe < m_frames.size(); ++iframe) {
+    const auto& frame = m_frames[iframe];
+    const auto& all_traces = *frame->traces();
+    const auto& ttinds = frame->tagged_traces(tag);
+    size_t ntagged = ttinds.size();
+    if (!ntagged) {
+      auto ftags = frame->frame_tags();
+      if (std::find(ftags.begin(), ftags.end(), tag) == ftags.end()) { continue; }
+      ntagged = all_traces.size();
+    }
+    if (summary) {
+      const auto& values = frame->trace_summary(tag);
+      if (values.size() != ntagged) { continue; }
+      group.values.insert(group.values.end(), values.begin(), values.end());
+    }
+    for (size_t pos = 0; pos < ntagged; ++pos) {
+      group.traces.push_back(all_traces[ttinds.size() ? ttinds[pos] : pos].get());
     }
+    group.frames.insert(group.frames.end(), ntagged, iframe);
+  }
+
+  // Count into s+2 so that after the prefix sum s+1 holds the start
+  // of slot s and placing advances it to the start of slot s+1.
+  auto& offsets = group.offsets;
+  const size_t ntraces = group.traces.size();
+  const size_t nslots = m_channels.size();
+  group.slots.resize(ntraces);
+  offsets.assign(nslots + 2, 0);
+  for (size_t pos = 0; pos < ntraces; ++pos) {
+    const int islot = slot(group.traces[pos]->channel());
+    group.slots[pos] = islot;
+    if (islot >= 0) { ++offsets[islot + 2]; }
+  }
+  for (size_t ind = 2; ind < nslots + 2; ++ind) {
+    offsets[ind] += offsets[ind - 1];
+  }
+  group.order.resize(offsets[nslots + 1]);
+  for (size_t pos = 0; pos < ntraces; ++pos) {
+    if (group.slots[pos] >= 0) { group.order[offsets[group.slots[pos] + 1]++] = pos; }
+  }
+  offsets.pop_back();
+}
+
+// Call save_tag(iftag) for each frame tag, in parallel if so
+// configured.
+void FrameSaver::for_each_tag(const std::function<void(size_t)>& save_tag)
+{
+  const size_t nftags = m_frame_tags.size();
+  if (m_groups.size() < nftags) { m_groups.resize(nftags); }
+  if (m_parallel) {
+    tbb::parallel_for(size_t(0), nftags, save_tag);
     return;
   }
-  auto ftags = frame->frame_tags();
-  if (std::find(ftags.begin(), ftags.end(), tag) == ftags.end()) { return; }
-  ret.insert(ret.begin(), all_traces->begin(), all_traces->end());
+  for (size_t iftag = 0; iftag < nftags; ++iftag) {
+    save_tag(iftag);
+  }
+}
+
+// Return the stream of a time slice: the frame ident and, if split
+// by anode, its "anode<ident>" frame tag.
+static std::pair<int, std::string> slice_stream(const IFrame::pointer& frame)
+{
+  for (const auto& ftag : frame->frame_tags()) {
+    if (ftag.rfind("anode", 0) == 0) { return std::make_pair(frame->ident(), ftag); }
+  }
+  return std::make_pair(frame->ident(), std::string());
+}
+
+// Place each frame at its tick offset from the earliest.  Each owns
+// all ticks from zero on and where frames overlap the later one wins.
+void FrameSaver::place_frames()
+{
+  const size_t nframes = m_frames.size();
+  const double tick = m_frames.front()->tick();
+  double time0 = m_frames.front()->time();
+  for (const auto& frame : m_frames) {
+    if (std::abs(frame->tick() - tick) > 1e-6 * tick) {
+      THROW(ValueError() << errmsg{"FrameSaver can not merge frames of differing ticks"});
+    }
+    time0 = std::min(time0, frame->time());
+  }
+  m_shifts.resize(nframes);
+  for (size_t iframe = 0; iframe < nframes; ++iframe) {
+    m_shifts[iframe] = std::lround((m_frames[iframe]->time() - time0) / tick);
+  }
+  m_lo.assign(nframes, 0);
+  m_hi.assign(nframes, std::numeric_limits<int>::max());
 }
 
-typedef std::unordered_map<int, ITrace::vector> traces_bychan_t;
-static void traces_bychan(ITrace::vector& traces, traces_bychan_t& ret)
+// Take a time slice of a stream of one readout.  Slices are placed at
+// their tick offset from the first slice of the event.  Where a slice
+// overlaps the previous one of its stream each owns the ticks up to the
+// middle of the overlap, so the previous slice is saved once the next
+// arrives and is then released.  At most one slice per stream is held.
+void FrameSaver::stitch_slice(const IFrame::pointer& frame)
 {
-  for (auto trace : traces) {
-    int chid = trace->channel();
-    ret[chid].push_back(trace);
+  if (m_slices.empty() && !m_out.nframes) {
+    m_slice_time0 = frame->time();
+    m_slice_tick = frame->tick();
+  }
+  else if (std::abs(frame->tick() - m_slice_tick) > 1e-6 * m_slice_tick) {
+    THROW(ValueError() << errmsg{"FrameSaver can not stitch slices of differing ticks"});
+  }
+  Slice slice{frame, int(std::lround((frame->time() - m_slice_time0) / m_slice_tick)), 0, 0};
+  slice.end = slice.shift;
+  for (const auto& trace : *frame->traces()) {
+    slice.end = std::max<int>(slice.end, slice.shift + trace->tbin() + trace->charge().size());
+  }
+
+  auto key = slice_stream(frame);
+  auto it = m_slices.find(key);
+  if (it == m_slices.end()) {
+    m_slices.emplace(key, slice);
+    return;
+  }
+  auto& prev = it->second;
+  if (slice.shift < prev.shift) {
+    THROW(ValueError() << errmsg{"FrameSaver requires the slices of a stream in time order"});
+  }
+  int hi = prev.end;
+  slice.lo = prev.end;
+  if (slice.end > slice.shift && prev.end > slice.shift) {
+    hi = slice.lo = (slice.shift + prev.end) / 2;
   }
+  save_slice(prev, hi);
+  prev = slice;
+}
+
+// Save the ticks [lo, hi) of a slice.
+void FrameSaver::save_slice(const Slice& slice, int hi)
+{
+  m_frames.assign(1, slice.frame);
+  m_shifts.assign(1, slice.shift);
+  m_lo.assign(1, std::max(slice.lo, 0));
+  m_hi.assign(1, hi);
+  fill_frames(nticks_want(nullptr));
+  m_frames.clear();
+}
+
+// Return the absolute tick of the first sample of a grouped trace and
+// the range of its samples in the ticks owned by its frame.
+FrameSaver::Span FrameSaver::span(const Grouping& group, size_t pos) const
+{
+  const size_t iframe = group.frames[pos];
+  const int tbin = m_shifts[iframe] + group.traces[pos]->tbin();
+  const long size = group.traces[pos]->charge().size();
+  const long beg = std::clamp<long>(long(m_lo[iframe]) - tbin, 0, size);
+  const long end = std::clamp<long>(long(m_hi[iframe]) - tbin, beg, size);
+  return Span{tbin, size_t(beg), size_t(end)};
+}
+
+// Return the number of ticks to force output waveforms to, zero if
+// not forced or, lacking the event to ask for it, not yet known.
+int FrameSaver::nticks_want(const art::Event* event) const
+{
+  if (m_nticks >= 0) { return m_nticks; }
+  if (!event) { return 0; }
+  auto const detProp =
+    art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(*event);
+  return detProp.NumberTimeSamples();
 }
 
 // Issolate some silly legacy shenanigans to keep the rest of the code
 // blissfully ignorant of the evilness this implies.
 struct PU {
   Json::Value pu;
+  const std::unordered_map<int, float>& cache;
 
-  PU(Json::Value pu) : pu(pu) {}
+  PU(Json::Value pu, const std::unordered_map<int, float>& cache) : pu(pu), cache(cache) {}
 
   float operator()(int chid)
   {
     if (pu.isNumeric()) { return pu.asFloat(); }
     if (pu.asString() == "fiction") {
+      auto it = cache.find(chid);
+      if (it != cache.end()) { return it->second; }
       art::ServiceHandle<lariov::DetPedestalService const> dps;
       const auto& pv = dps->GetPedestalProvider();
       return pv.PedMean(chid);
@@ -262,209 +489,348 @@ struct PU {
   }
 };
 
-void FrameSaver::save_as_raw(art::Event& event)
+// The pedestal service may be backed by a database which sets its
+// IOV timestamp as each event is prepared.  So the cache is only
+// marked stale here and is filled on the first event of the run.
+void FrameSaver::beginRun(art::Run const& run)
 {
-  int nticks_want = m_nticks;
-  if (nticks_want < 0) {
-    auto const detProp =
-      art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(event);
-    nticks_want = detProp.NumberTimeSamples();
-  }
-
-  size_t nftags = m_frame_tags.size();
-  for (size_t iftag = 0; iftag < nftags; ++iftag) {
-    std::string ftag = m_frame_tags[iftag];
-    std::cerr << "wclsFrameSaver: saving raw::RawDigits tagged \"" << ftag << "\"\n";
+  m_fiction_pedestals.clear();
+  m_fiction_stale = true;
+}
 
-    double scale = m_frame_scale[iftag];
+void FrameSaver::endRun(art::Run const& run)
+{
+  m_fiction_pedestals.clear();
+  m_fiction_stale = true;
+}
 
-    ITrace::vector traces;
-    tagged_traces(m_frame, ftag, traces);
-    traces_bychan_t bychan;
-    traces_bychan(traces, bychan);
+void FrameSaver::cache_fiction_pedestals()
+{
+  m_fiction_stale = false;
+  m_fiction_pedestals.clear();
+  if (!m_digitize || m_pedestal_mean.isNumeric() || m_pedestal_mean.asString() != "fiction") {
+    return;
+  }
+  art::ServiceHandle<lariov::DetPedestalService const> dps;
+  const auto& pv = dps->GetPedestalProvider();
+  for (int chid : m_channels) {
+    m_fiction_pedestals[chid] = pv.PedMean(chid);
+  }
+}
 
-    std::unique_ptr<std::vector<raw::RawDigit>> out(new std::vector<raw::RawDigit>);
+// Empty the output and size it for the next event.
+void FrameSaver::reset_output()
+{
+  const size_t nftags = m_frame_tags.size();
+  const size_t nstags = m_summary_tags.size();
+  const size_t nslots = m_channels.size();
+  const size_t ncmms = m_cmms.isArray() ? m_cmms.size() : 0;
+  m_out.nframes = 0;
+  m_out.ntraces.assign(nftags, 0);
+  m_out.adcs.assign(m_digitize && !m_skipframe ? nftags : 0, {});
+  m_out.rois.assign(!m_digitize && !m_skipframe ? nftags : 0, {});
+  m_out.charges.assign(m_out.rois.size(), std::vector<double>(nslots, 0.0));
+  m_out.samples.assign(m_out.rois.size(), std::vector<int>(nslots, 0));
+  for (auto& adcs : m_out.adcs) {
+    adcs.resize(nslots);
+  }
+  for (auto& rois : m_out.rois) {
+    rois.resize(nslots);
+  }
+  m_out.values.assign(nstags, std::vector<IFrame::trace_summary_t>(nslots));
+  m_out.masks.assign(ncmms, {});
+  m_out.found.assign(ncmms, false);
+}
 
-    for (auto chv : m_chview) {
-      const int chid = chv.first;
-      const auto& traces = bychan[chid];
-      const size_t ntraces = traces.size();
+// Add the frames being saved to the output.  Samples past nticks, if
+// nonzero, are skipped.
+void FrameSaver::fill_frames(int nticks)
+{
+  m_out.nframes += m_frames.size();
+  if (m_digitize && !m_skipframe) { fill_raw(nticks); }
+  else if (!m_digitize && !m_skipframe) {
+    fill_cooked(nticks);
+  }
+  fill_summaries();
+  fill_cmms();
+}
 
-      int tbin = 0;
-      std::vector<float> charge;
-      if (ntraces) {
-        auto trace = traces[0];
-        tbin = trace->tbin();
-        charge = trace->charge();
-      }
-      // charge may be empty here
-
-      // enforce number of ticks if we are so configured.
-      size_t ncharge = charge.size();
-      int nticks = tbin + ncharge;
-      if (nticks_want) { // force output waveform size
-        if (nticks_want < nticks) { ncharge = nticks_want - tbin; }
-        nticks = nticks_want;
-      }
-      raw::RawDigit::ADCvector_t adcv(nticks);
-      for (size_t ind = 0; ind < ncharge; ++ind) {
-        adcv[tbin + ind] = scale * charge[ind]; // scale + truncate/redigitize
+void FrameSaver::fill_raw(int nticks)
+{
+  const size_t nslots = m_channels.size();
+
+  // Each tag fills its own output by slot so the order is that of the
+  // channels however the work is shared.
+  auto save_tag = [&](size_t iftag) {
+    const double scale = m_frame_scale[iftag];
+    auto& group = m_groups[iftag];
+    group_traces(m_frame_tags[iftag], group);
+    m_out.ntraces[iftag] += group.traces.size();
+    auto& adcs = m_out.adcs[iftag];
+
+    auto fill = [&](const tbb::blocked_range<size_t>& range) {
+      for (size_t islot = range.begin(); islot != range.end(); ++islot) {
+        auto& adcv = adcs[islot];
+        // the traces of the channel from all frames, read in place
+        for (size_t ind = group.offsets[islot]; ind < group.offsets[islot + 1]; ++ind) {
+          const Span sp = span(group, group.order[ind]);
+          const auto& charge = group.traces[group.order[ind]]->charge();
+          long end = sp.end;
+          if (nticks) { // enforce number of ticks if we are so configured.
+            end = std::min<long>(end, long(nticks) - sp.tbin);
+            adcv.reserve(nticks);
+          }
+          if (long(sp.beg) >= end) { continue; }
+          if (long(adcv.size()) < sp.tbin + end) { adcv.resize(sp.tbin + end, 0); }
+          for (long isample = sp.beg; isample < end; ++isample) {
+            adcv[sp.tbin + isample] = scale * charge[isample]; // scale + truncate/redigitize
+          }
+        }
       }
-      out->emplace_back(raw::RawDigit(chid, nticks, adcv, raw::kNone));
-      if (m_pedestal_mean.asString() == "native") {
-        short baseline = Waveform::most_frequent(adcv);
-        out->back().SetPedestal(baseline, m_pedestal_sigma);
+    };
+    if (m_parallel) {
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, nslots, m_grain_size), fill);
+    }
+    else {
+      fill(tbb::blocked_range<size_t>(0, nslots));
+    }
+  };
+  for_each_tag(save_tag);
+}
+
+void FrameSaver::fill_cooked(int nticks)
+{
+  const size_t nslots = m_channels.size();
+
+  // Each tag fills its own output by slot so the order is that of the
+  // channels however the work is shared.  The charge and sample
+  // totals are kept per slot and summed in slot order so they do not
+  // depend on the sharing either.
+  auto save_tag = [&](size_t iftag) {
+    const double scale = m_frame_scale[iftag];
+    auto& group = m_groups[iftag];
+    group_traces(m_frame_tags[iftag], group);
+    m_out.ntraces[iftag] += group.traces.size();
+    auto& slot_rois = m_out.rois[iftag];
+    auto& slot_charge = m_out.charges[iftag];
+    auto& slot_samples = m_out.samples[iftag];
+
+    auto fill = [&](const tbb::blocked_range<size_t>& range) {
+      for (size_t islot = range.begin(); islot != range.end(); ++islot) {
+        const int chid = m_channels[islot];
+        double total_charge = 0.0;
+        int total_samples = 0;
+        auto& rois = slot_rois[islot];
+
+        for (size_t ind = group.offsets[islot]; ind < group.offsets[islot + 1]; ++ind) {
+          const Span sp = span(group, group.order[ind]);
+          if (sp.beg >= sp.end) { continue; } // owned by another frame
+          const int tbin = sp.tbin;
+          const auto& charge = group.traces[group.order[ind]]->charge();
+
+          size_t beg = sp.beg, end = sp.end;
+          if (nticks) { // user set waveform size
+            if (tbin + long(beg) >= nticks) { beg = end; }
+            else {
+              end = std::min<size_t>(end, nticks - tbin);
+            }
+          }
+          if (beg >= end) {
+            std::cerr << "wclsFrameSaver: no samples within desired window for channel " << chid
+                      << "\n";
+            continue;
+          }
+          // Samples are scaled as they are copied into the ROI storage.
+          const float* pfirst = charge.data();
+          const float* pbeg = pfirst + beg;
+          const float* pend = pfirst + end;
+          if (!m_sparse) {
+            // prefer combine_range() but it segfaults.
+            rois.add_range(tbin + beg,
+                           sparsify::ScaledIterator(pbeg, scale),
+                           sparsify::ScaledIterator(pend, scale));
+            continue;
+          }
+          // sparsify trace whether or not it may itself already
+          // represents a sparse ROI
+          sparsify::for_each_roi(
+            pbeg, pend, m_sparsify, scale, [&](const float* rbeg, const float* rend) {
+              for (const float* ptr = rbeg; ptr != rend; ++ptr) {
+                total_charge += float(*ptr * scale);
+              }
+              total_samples += rend - rbeg;
+              rois.add_range(tbin + (rbeg - pfirst),
+                             sparsify::ScaledIterator(rbeg, scale),
+                             sparsify::ScaledIterator(rend, scale));
+            });
+        }
+
+        slot_charge[islot] += total_charge;
+        slot_samples[islot] += total_samples;
       }
-      else {
-        PU pu(m_pedestal_mean);
-        out->back().SetPedestal(pu(chid), m_pedestal_sigma);
+    };
+    if (m_parallel) {
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, nslots, m_grain_size), fill);
+    }
+    else {
+      fill(tbb::blocked_range<size_t>(0, nslots));
+    }
+  };
+  for_each_tag(save_tag);
+}
+
+void FrameSaver::fill_summaries()
+{
+  const size_t ntags = m_summary_tags.size();
+  const size_t nchans = m_channels.size();
+  if (m_groups.empty()) { m_groups.resize(1); }
+
+  // The "summary" and "traces" vectors of the same tag are
+  // synced, element-by-element.  Each element corresponds to
+  // one trace (ROI).  No particular order or correlation by
+  // channel exists, and that's what the rest of this code
+  // creates.
+  for (size_t tag_ind = 0; tag_ind < ntags; ++tag_ind) {
+    auto& group = m_groups[0];
+    group_traces(m_summary_tags[tag_ind], group, true);
+    auto& values = m_out.values[tag_ind];
+    for (size_t islot = 0; islot < nchans; ++islot) {
+      for (size_t ind = group.offsets[islot]; ind < group.offsets[islot + 1]; ++ind) {
+        values[islot].push_back(group.values[group.order[ind]]);
       }
     }
-    event.put(std::move(out), ftag);
   }
 }
 
-void FrameSaver::save_as_cooked(art::Event& event)
+// Merge the masks of the frames, shifted by their tick offset and
+// kept to the ticks each frame owns.
+void FrameSaver::fill_cmms()
 {
-  int nticks_want = m_nticks;
-  if (nticks_want < 0) {
-    auto const detProp =
-      art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(event);
-    nticks_want = detProp.NumberTimeSamples();
-    std::cerr << "wclsFrameSaver saving cooked to " << nticks_want << " ticks\n";
+  const size_t ncmms = m_out.masks.size();
+  for (size_t icmm = 0; icmm < ncmms; ++icmm) {
+    const std::string name = m_cmms[int(icmm)].asString();
+    auto& chmasks = m_out.masks[icmm];
+    for (size_t iframe = 0; iframe < m_frames.size(); ++iframe) {
+      auto cmm = m_frames[iframe]->masks();
+      auto it = cmm.find(name);
+      if (it == cmm.end()) { continue; }
+      m_out.found[icmm] = true;
+      for (const auto& [chid, ranges] : it->second) {
+        auto& out = chmasks[chid];
+        for (const auto& range : ranges) {
+          const int beg = std::max(range.first + m_shifts[iframe], m_lo[iframe]);
+          const int end = std::min(range.second + m_shifts[iframe], m_hi[iframe]);
+          if (beg < end) { out.push_back(std::make_pair(beg, end)); }
+        }
+      }
+    }
   }
+}
 
-  size_t nftags = m_frame_tags.size();
-  for (size_t iftag = 0; iftag < nftags; ++iftag) {
-    std::string ftag = m_frame_tags[iftag];
-
-    double scale = m_frame_scale[iftag];
-
-    ITrace::vector traces;
-    tagged_traces(m_frame, ftag, traces);
-    if (traces.empty()) {
-      std::cerr << "wclsFrameSaver: no traces tagged \"" << ftag << "\"\n";
-      // fall through loop so we put (empty) outwires
+void FrameSaver::put_raw(art::Event& event)
+{
+  const int nticks = nticks_want(&event);
+  const size_t nftags = m_frame_tags.size();
+  const size_t nslots = m_channels.size();
+  const bool native = m_pedestal_mean.asString() == "native";
+  if (m_fiction_stale) { cache_fiction_pedestals(); }
+  PU pu(m_pedestal_mean, m_fiction_pedestals);
+
+  std::vector<std::unique_ptr<std::vector<raw::RawDigit>>> outs(nftags);
+  auto save_tag = [&](size_t iftag) {
+    outs[iftag] = std::make_unique<std::vector<raw::RawDigit>>(nslots);
+    auto& out = *outs[iftag];
+    auto& adcs = m_out.adcs[iftag];
+    auto fill = [&](const tbb::blocked_range<size_t>& range) {
+      for (size_t islot = range.begin(); islot != range.end(); ++islot) {
+        const int chid = m_channels[islot];
+        auto& adcv = adcs[islot];
+        if (nticks) { // force output waveform size
+          adcv.resize(nticks, 0);
+        }
+        const size_t nsamples = adcv.size();
+        const float pedestal = native ? Waveform::most_frequent(adcv) : pu(chid);
+        out[islot] = raw::RawDigit(chid, nsamples, std::move(adcv), raw::kNone);
+        out[islot].SetPedestal(pedestal, m_pedestal_sigma);
+      }
+    };
+    if (m_parallel) {
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, nslots, m_grain_size), fill);
     }
     else {
-      std::cerr << "wclsFrameSaver: saving " << traces.size() << " traces tagged \"" << ftag
-                << "\"\n";
+      fill(tbb::blocked_range<size_t>(0, nslots));
     }
+  };
+  for_each_tag(save_tag);
 
-    traces_bychan_t bychan;
-    traces_bychan(traces, bychan);
-
-    std::unique_ptr<std::vector<recob::Wire>> outwires(new std::vector<recob::Wire>);
-
-    double total_charge = 0.0;
-    int total_samples = 0;
-
-    for (auto chv : m_chview) {
-      const int chid = chv.first;
-      const auto& traces = bychan[chid];
-
-      recob::Wire::RegionsOfInterest_t rois(nticks_want);
+  for (size_t iftag = 0; iftag < nftags; ++iftag) {
+    const std::string& ftag = m_frame_tags[iftag];
+    std::cerr << "wclsFrameSaver: saving raw::RawDigits tagged \"" << ftag << "\"\n";
+    event.put(std::move(outs[iftag]), ftag);
+  }
+}
 
-      for (const auto& trace : traces) {
-        const int tbin = trace->tbin();
-        const auto& charge = trace->charge();
+void FrameSaver::put_cooked(art::Event& event)
+{
+  const int nticks = nticks_want(&event);
+  if (m_nticks < 0) { std::cerr << "wclsFrameSaver saving cooked to " << nticks << " ticks\n"; }
 
-        auto beg = charge.begin();
-        const auto first = beg;
-        auto end = charge.end();
-        if (nticks_want) { // user set waveform size
-          if (tbin >= nticks_want) { beg = end; }
-          else {
-            int backup = tbin + charge.size() - nticks_want;
-            if (backup > 0) { end -= backup; }
-          }
-        }
-        if (beg >= end) {
-          std::cerr << "wclsFrameSaver: no samples within desired window for channel " << chid
-                    << "\n";
-          continue;
-        }
-        if (!m_sparse) {
-          std::vector<float> scaled(beg, end);
-          for (size_t i = 0; i < scaled.size(); ++i)
-            scaled[i] *= scale;
-          // prefer combine_range() but it segfaults.
-          rois.add_range(tbin, scaled.begin(), scaled.end());
-          continue;
-        }
-        // sparsify trace whether or not it may itself already
-        // represents a sparse ROI
-        while (true) {
-          beg = std::find_if(beg, end, [](float v) { return v != 0.0; });
-          if (beg == end) { break; }
-          auto mid = std::find_if(beg, end, [](float v) { return v == 0.0; });
-          std::vector<float> scaled(beg, mid);
-          for (int ind = 0; ind < mid - beg; ++ind) {
-            scaled[ind] *= scale;
-            total_charge += scaled[ind];
-            ++total_samples;
-          }
-          rois.add_range(tbin + beg - first, scaled.begin(), scaled.end());
-          beg = mid;
-        }
-      }
+  const size_t nftags = m_frame_tags.size();
+  const size_t nslots = m_channels.size();
+  for (size_t iftag = 0; iftag < nftags; ++iftag) {
+    const std::string& ftag = m_frame_tags[iftag];
+    auto outwires = std::make_unique<std::vector<recob::Wire>>(nslots);
+    auto& slot_rois = m_out.rois[iftag];
+    for (size_t islot = 0; islot < nslots; ++islot) {
+      auto& rois = slot_rois[islot];
+      if (nticks) { rois.resize(nticks); }
+      (*outwires)[islot] = recob::Wire(std::move(rois), m_channels[islot], m_views[islot]);
+    }
 
-      const geo::View_t view = chv.second;
-      outwires->emplace_back(recob::Wire(rois, chid, view));
+    const size_t ntagged = m_out.ntraces[iftag];
+    if (!ntagged) {
+      std::cerr << "wclsFrameSaver: no traces tagged \"" << ftag << "\"\n";
+      // we still put (empty) outwires
     }
+    else {
+      std::cerr << "wclsFrameSaver: saving " << ntagged << " traces tagged \"" << ftag << "\"\n";
+    }
+    const auto& charges = m_out.charges[iftag];
+    const auto& samples = m_out.samples[iftag];
+    const double total_charge = std::accumulate(charges.begin(), charges.end(), 0.0);
+    const int total_samples = std::accumulate(samples.begin(), samples.end(), 0);
     std::cerr << "FrameSaver: q=" << total_charge << " n=" << total_samples << " tag=" << ftag
               << "\n";
     event.put(std::move(outwires), ftag);
   } // loop over tags
 }
 
-void FrameSaver::save_summaries(art::Event& event)
+void FrameSaver::put_summaries(art::Event& event)
 {
-  const int ntags = m_summary_tags.size();
-  if (0 == ntags) {
-    return; // no tags
-  }
-
-  const size_t nchans = m_chview.size();
+  const size_t ntags = m_summary_tags.size();
+  const size_t nchans = m_channels.size();
+  std::vector<float> chvals; // summary values of one channel
 
   // for each summary
-  for (int tag_ind = 0; tag_ind < ntags; ++tag_ind) {
+  for (size_t tag_ind = 0; tag_ind < ntags; ++tag_ind) {
     // The scale set for the tag.
     const double scale = m_summary_scale[tag_ind];
 
     std::unique_ptr<std::vector<double>> outsum(new std::vector<double>(nchans, 0.0));
 
-    // The "summary" and "traces" vectors of the same tag are
-    // synced, element-by-element.  Each element corresponds to
-    // one trace (ROI).  No particular order or correlation by
-    // channel exists, and that's what the rest of this code
-    // creates.
     auto tag = m_summary_tags[tag_ind];
-    const auto& summary = m_frame->trace_summary(tag);
-    ITrace::vector traces;
-    tagged_traces(m_frame, tag, traces);
-    const size_t ntraces = traces.size();
-
-    std::unordered_map<int, std::vector<float>> bychan;
-    for (size_t itrace = 0; itrace < ntraces; ++itrace) {
-      const int chid = traces[itrace]->channel();
-      const double summary_value = summary[itrace];
-      bychan[chid].push_back(summary_value);
-    }
     auto oper = m_summary_operators[tag];
-
-    size_t chanind = 0;
-    for (auto chv : m_chview) {
-      const int chid = chv.first;
-      const float val = oper(bychan[chid]);
-      outsum->at(chanind) = val * scale;
-      ++chanind;
+    const auto& values = m_out.values[tag_ind];
+    for (size_t islot = 0; islot < nchans; ++islot) {
+      chvals.assign(values[islot].begin(), values[islot].end());
+      const float val = oper(chvals);
+      outsum->at(islot) = val * scale;
     }
     event.put(std::move(outsum), tag);
   }
 }
 
-void FrameSaver::save_cmms(art::Event& event)
+void FrameSaver::put_cmms(art::Event& event)
 {
   if (m_cmms.isNull()) { return; }
   if (!m_cmms.isArray()) {
@@ -472,18 +838,16 @@ void FrameSaver::save_cmms(art::Event& event)
       << "wclsFrameSaver: wrong type for configuration array of channel mask maps to save\n";
     return;
   }
-  for (auto jcmm : m_cmms) {
-    std::string name = jcmm.asString();
+  for (size_t icmm = 0; icmm < m_out.masks.size(); ++icmm) {
+    std::string name = m_cmms[int(icmm)].asString();
     std::unique_ptr<channel_list> out_list(new channel_list);
     std::unique_ptr<channel_masks> out_masks(new channel_masks);
 
-    auto cmm = m_frame->masks();
-    auto it = cmm.find(name);
-    if (it == cmm.end()) {
+    if (!m_out.found[icmm]) {
       std::cerr << "wclsFrameSaver: failed to find requested channel masks \"" << name << "\"\n";
     }
     else {
-      for (auto cmit : it->second) { // int->vec<pair<int,int>>
+      for (auto cmit : m_out.masks[icmm]) { // int->vec<pair<int,int>>
         out_list->push_back(cmit.first);
         for (auto be : cmit.second) {
           out_masks->push_back(cmit.first);
@@ -533,37 +897,50 @@ void FrameSaver::save_empty(art::Event& event)
 
 void FrameSaver::visit(art::Event& event)
 {
-  if (!m_frame) {
-    save_empty(event);
-    return;
+  if (m_stitch) {
+    // The last slice of each stream owns the rest of the readout.
+    const size_t nstreams = m_slices.size();
+    for (const auto& [stream, slice] : m_slices) {
+      save_slice(slice, std::numeric_limits<int>::max());
+    }
+    m_slices.clear();
+    if (nstreams) {
+      std::cerr << "wclsFrameSaver: stitched " << m_out.nframes << " slices of " << nstreams
+                << " streams\n";
+    }
   }
-
-  if (m_digitize && !m_skipframe) { save_as_raw(event); }
-  else if (!m_digitize && !m_skipframe) {
-    save_as_cooked(event);
+  else if (!m_frames.empty()) {
+    place_frames();
+    if (m_frames.size() > 1) {
+      std::cerr << "wclsFrameSaver: saving " << m_frames.size() << " frames\n";
+    }
+    fill_frames(nticks_want(&event));
+    m_frames.clear(); // done with stashed frames
   }
 
-  save_summaries(event);
-
-  save_cmms(event);
-
-  m_frame = nullptr; // done with stashed frame
+  if (!m_out.nframes) { save_empty(event); }
+  else {
+    if (m_digitize && !m_skipframe) { put_raw(event); }
+    else if (!m_digitize && !m_skipframe) {
+      put_cooked(event);
+    }
+    put_summaries(event);
+    put_cmms(event);
+  }
+  reset_output();
 }
 
 bool FrameSaver::operator()(const WireCell::IFrame::pointer& inframe,
                             WireCell::IFrame::pointer& outframe)
 {
-  // set an IFrame based on last visited event.
+  // Save slices as they come, queue other IFrames to save at the
+  // next visited event.
   outframe = inframe;
   if (inframe) {
-    if (m_frame) {
-      std::cerr
-        << "wclsFrameSaver: warning: dropping prior frame.  Fixme to handle queue of frames.\n";
-    }
-    // else {
-    //     std::cerr << "wclsFrameSaver got frame\n";
-    // }
-    m_frame = inframe;
+    if (m_stitch) { stitch_slice(inframe); }
+    else {
+      m_frames.push_back(inframe);
+    }
   }
   // else {
   //     std::cerr << "wclsFrameSaver sees EOS\n";
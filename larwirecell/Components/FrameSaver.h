@@ -9,6 +9,14 @@
  - channel mask maps as vector<int> holding channel numbers
 
  It can be configured to scale waveform or summary values by some constant.
+
+ All frames received between events are saved together.  Each is
+ placed at its tick offset from the earliest and the traces of a
+ channel from all frames go to the one output element of the
+ channel.  Where frames overlap in time, the later frame wins.
+
+ It can also be configured to treat the frames as a sequence of time
+ slices, trimming their overlaps and saving each as it arrives.
 */
 
 #ifndef LARWIRECELL_COMPONENTS_FRAMESAVER
@@ -16,7 +24,11 @@
 
 #include "WireCellIface/IConfigurable.h"
 #include "WireCellIface/IFrameFilter.h"
+#include "WireCellUtil/Waveform.h"
+#include "Sparsify.h"
 #include "larcoreobj/SimpleTypesAndConstants/geo_types.h"
+#include "lardataobj/RawData/RawDigit.h"
+#include "lardataobj/RecoBase/Wire.h"
 #include "larwirecell/Interfaces/IArtEventVisitor.h"
 
 #include <functional>
@@ -37,6 +49,8 @@ namespace wcls {
     /// IArtEventVisitor
     virtual void produces(art::ProducesCollector& collector);
     virtual void visit(art::Event& event);
+    virtual void beginRun(art::Run const& run);
+    virtual void endRun(art::Run const& run);
 
     /// IFrameFilter
     virtual bool operator()(const WireCell::IFrame::pointer& inframe,
@@ -68,10 +82,59 @@ namespace wcls {
     typedef std::vector<int> channel_masks;
 
   private:
-    // ordered.
-    std::map<int, geo::View_t> m_chview;
-
-    WireCell::IFrame::pointer m_frame;
+    // Output channels and their views in channel order.  The slot
+    // of a channel is its index in these, found through a dense
+    // lookup offset by the smallest channel ID.
+    std::vector<int> m_channels;
+    std::vector<geo::View_t> m_views;
+    int m_chmin{0};
+    std::vector<int> m_chslot;
+
+    // Traces of one tag from all frames grouped by slot.  See
+    // group_traces().  One per frame tag is kept as scratch reused
+    // across events, the first also serves the summaries.
+    struct Grouping {
+      std::vector<const WireCell::ITrace*> traces;
+      std::vector<size_t> frames;
+      WireCell::IFrame::trace_summary_t values;
+      std::vector<size_t> order, offsets;
+      std::vector<int> slots;
+    };
+    std::vector<Grouping> m_groups;
+
+    bool m_parallel{false};
+    int m_grain_size{256};
+
+    // Frames being saved, the tick offset of each from the earliest
+    // and the ticks [lo, hi) each owns.  Unless stitching, these are
+    // the frames received since the last event.
+    std::vector<WireCell::IFrame::pointer> m_frames;
+    std::vector<int> m_shifts, m_lo, m_hi;
+
+    // When stitching, the latest slice of each stream, keyed by frame
+    // ident and anode tag, its tick offset from the first slice of the
+    // event, the tick it owns from and one past its last sample.
+    struct Slice {
+      WireCell::IFrame::pointer frame;
+      int shift, lo, end;
+    };
+    std::map<std::pair<int, std::string>, Slice> m_slices;
+    double m_slice_time0{0}, m_slice_tick{0};
+
+    // The output of the event filled by slot as frames are saved and
+    // put to the event when visited.
+    struct Output {
+      size_t nframes{0};
+      std::vector<size_t> ntraces;                                        // [ftag]
+      std::vector<std::vector<raw::RawDigit::ADCvector_t>> adcs;          // [ftag][slot]
+      std::vector<std::vector<recob::Wire::RegionsOfInterest_t>> rois;    // [ftag][slot]
+      std::vector<std::vector<double>> charges;                           // [ftag][slot]
+      std::vector<std::vector<int>> samples;                              // [ftag][slot]
+      std::vector<std::vector<WireCell::IFrame::trace_summary_t>> values; // [stag][slot]
+      std::vector<WireCell::Waveform::ChannelMasks> masks;                // [cmm]
+      std::vector<bool> found;                                            // [cmm]
+    };
+    Output m_out;
     std::vector<std::string> m_frame_tags, m_summary_tags;
     std::vector<double> m_frame_scale, m_summary_scale;
 
@@ -80,13 +143,41 @@ namespace wcls {
 
     int m_nticks;
     bool m_digitize, m_sparse, m_skipframe;
+    sparsify::Policy m_sparsify;
+    bool m_stitch{false};
     Json::Value m_cmms, m_pedestal_mean;
     double m_pedestal_sigma;
 
-    void save_as_raw(art::Event& event);
-    void save_as_cooked(art::Event& event);
-    void save_summaries(art::Event& event);
-    void save_cmms(art::Event& event);
+    // Per-run cache of "fiction" pedestals by channel, filled on the
+    // first event of the run.
+    std::unordered_map<int, float> m_fiction_pedestals;
+    bool m_fiction_stale{true};
+    void cache_fiction_pedestals();
+
+    int slot(int chid) const;
+    void group_traces(const std::string& tag, Grouping& group, bool summary = false) const;
+    void for_each_tag(const std::function<void(size_t)>& save_tag);
+    // The absolute tick of the first sample of a trace and its
+    // samples [beg, end) in ticks owned by its frame.
+    struct Span {
+      int tbin;
+      size_t beg, end;
+    };
+    Span span(const Grouping& group, size_t pos) const;
+    void place_frames();
+    void stitch_slice(const WireCell::IFrame::pointer& frame);
+    void save_slice(const Slice& slice, int hi);
+    int nticks_want(const art::Event* event) const;
+    void reset_output();
+    void fill_frames(int nticks);
+    void fill_raw(int nticks);
+    void fill_cooked(int nticks);
+    void fill_summaries();
+    void fill_cmms();
+    void put_raw(art::Event& event);
+    void put_cooked(art::Event& event);
+    void put_summaries(art::Event& event);
+    void put_cmms(art::Event& event);
     void save_empty(art::Event& event);
   };
 }
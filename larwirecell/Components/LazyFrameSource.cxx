@@ -1,4 +1,5 @@
 #include "LazyFrameSource.h"
+#include "RawTrace.h"
 #include "art/Framework/Principal/Handle.h"
 
 // for tick
@@ -9,89 +10,56 @@
 
 #include "TTimeStamp.h"
 
-#include "WireCellIface/IFrame.h"
+#include "WireCellAux/SimpleFrame.h"
 
-namespace wcls {
-
-  class LazyTrace : public WireCell::ITrace {
-    mutable art::Handle<std::vector<raw::RawDigit>> m_rdvh;
-    size_t m_index;
-    int m_channel;
-
-    mutable WireCell::ITrace::ChargeSequence m_charge;
+#include <memory>
+#include <mutex>
+#include <numeric>
 
-  public:
-    LazyTrace(art::Handle<std::vector<raw::RawDigit>> rdvh, size_t index)
-      : m_rdvh(rdvh), m_index(index), m_channel(rdvh->at(index).Channel())
-    {}
-
-    virtual int channel() const { return m_channel; }
-    virtual int tbin() const { return 0; }
-
-    virtual const ChargeSequence& charge() const
-    {
-      if (m_charge.empty()) {
-        auto const& rd = m_rdvh->at(m_index);
-        const raw::RawDigit::ADCvector_t& adcv = rd.ADCs();
-        //std::cerr << "trace " << m_index << " chan " << m_channel << " with " << adcv.size() << " samples\n";
-        m_charge.insert(m_charge.end(), adcv.begin(), adcv.end());
-        m_rdvh.clear(); // bye bye
-      }
-      return m_charge;
-    }
-  };
+namespace wcls {
 
-  class LazyFrame : public WireCell::IFrame {
-    int m_ident;
-    double m_time, m_tick;
-    tag_list_t m_tags;
-    WireCell::ITrace::shared_vector m_traces;
+  // A run of consecutive channels which are converted together the
+  // first time any one of them is read.
+  class LazyBlock {
+    std::once_flag m_once;
+    std::vector<std::unique_ptr<RawTrace>> m_traces;
 
   public:
-    LazyFrame(art::Handle<std::vector<raw::RawDigit>> rdvh,
-              int ident,
-              double time,
-              double tick,
-              const tag_list_t& tags)
-      : m_ident(ident), m_time(time), m_tick(tick), m_tags(tags.begin(), tags.end())
+    LazyBlock(const raw::RawDigit* rds,
+              size_t nrds,
+              unsigned int nticks,
+              std::pair<size_t, size_t> window)
     {
-      const size_t nrds = rdvh->size();
-      auto* traces = new std::vector<LazyTrace::pointer>(nrds);
+      m_traces.reserve(nrds);
       for (size_t ind = 0; ind < nrds; ++ind) {
-        traces->at(ind) = std::make_shared<LazyTrace>(rdvh, ind);
+        m_traces.push_back(
+          std::make_unique<RawTrace>(rds[ind], nticks, window.first, window.second));
       }
-      m_traces = WireCell::ITrace::shared_vector(traces);
     }
 
-    virtual ~LazyFrame() {}
-
-    virtual const tag_list_t& frame_tags() const { return m_tags; }
-
-    virtual const tag_list_t& trace_tags() const
-    {
-      static tag_list_t dummy; // this frame doesn't support trace tags
-      return dummy;
-    }
-
-    virtual const trace_list_t& tagged_traces(const tag_t& tag) const
-    {
-      static trace_list_t dummy; // this frame doesn't support trace tags
-      return dummy;
-    }
+    const RawTrace& trace(size_t index) const { return *m_traces[index]; }
 
-    virtual const trace_summary_t& trace_summary(const tag_t& tag) const
+    const RawTrace& materialize(size_t index)
     {
-      static trace_summary_t dummy; // this frame doesn't support trace tags
-      return dummy;
+      std::call_once(m_once, [this]() {
+        for (auto& trace : m_traces) {
+          trace->charge();
+        }
+      });
+      return *m_traces[index];
     }
+  };
 
-    virtual WireCell::ITrace::shared_vector traces() const { return m_traces; }
-
-    virtual int ident() const { return m_ident; }
+  class LazyTrace : public WireCell::ITrace {
+    std::shared_ptr<LazyBlock> m_block;
+    size_t m_index;
 
-    virtual double time() const { return m_time; }
+  public:
+    LazyTrace(std::shared_ptr<LazyBlock> block, size_t index) : m_block(block), m_index(index) {}
 
-    virtual double tick() const { return m_tick; }
+    virtual int channel() const { return m_block->trace(m_index).channel(); }
+    virtual int tbin() const { return m_block->trace(m_index).tbin(); }
+    virtual const ChargeSequence& charge() const { return m_block->materialize(m_index).charge(); }
   };
 
 }
@@ -105,6 +73,7 @@ WIRECELL_FACTORY(wclsLazyFrameSource,
 
 using namespace wcls;
 using namespace WireCell;
+using WireCell::Aux::SimpleFrame;
 
 LazyFrameSource::LazyFrameSource() : m_nticks(0) {}
 
@@ -117,6 +86,13 @@ WireCell::Configuration LazyFrameSource::default_configuration() const
   cfg["tick"] = 0.5 * WireCell::units::us;
   cfg["frame_tags"][0] = "orig"; // the tags to apply to this frame
   cfg["nticks"] = m_nticks; // if nonzero, truncate or baseline-pad frame to this number of ticks.
+  // If greater than one, channels are converted together in blocks
+  // of this many the first time any one of the block is read.
+  cfg["block_size"] = m_block_size;
+  // Tags under which to index all traces.
+  cfg["trace_tags"] = Json::arrayValue;
+  // Optional crop window, see CropWindow.
+  m_crop.default_configuration(cfg);
   return cfg;
 }
 
@@ -131,6 +107,12 @@ void LazyFrameSource::configure(const WireCell::Configuration& cfg)
     m_frame_tags.push_back(jtag.asString());
   }
   m_nticks = get(cfg, "nticks", m_nticks);
+  m_block_size = get(cfg, "block_size", m_block_size);
+  m_crop.configure(cfg);
+  m_trace_tags.clear();
+  for (auto jtag : cfg["trace_tags"]) {
+    m_trace_tags.push_back(jtag.asString());
+  }
 }
 
 // is this the right way to diff an art::Timestamp?
@@ -141,13 +123,18 @@ static double tdiff(const art::Timestamp& ts1, const art::Timestamp& ts2)
   return tts2.AsDouble() - tts1.AsDouble();
 }
 
+void LazyFrameSource::consumes(art::ConsumesCollector& collector)
+{
+  m_token = collector.consumes<std::vector<raw::RawDigit>>(m_inputTag);
+}
+
 void LazyFrameSource::visit(art::Event& event)
 {
   // fixme: want to avoid depending on DetectorPropertiesService for now.
   const double tick = m_tick;
 
   art::Handle<std::vector<raw::RawDigit>> rdvh;
-  bool okay = event.getByLabel(m_inputTag, rdvh);
+  bool okay = m_token ? event.getByToken(*m_token, rdvh) : event.getByLabel(m_inputTag, rdvh);
   if (!okay) {
     std::string msg = "LazyFrameSource failed to get vector<raw::RawDigit>: " + m_inputTag.encode();
     std::cerr << msg << std::endl;
@@ -156,10 +143,43 @@ void LazyFrameSource::visit(art::Event& event)
   else if (rdvh->size() == 0)
     return;
   const double time = tdiff(event.getRun().beginTime(), event.time());
+  const auto window = m_crop.range(event);
+
+  const std::vector<raw::RawDigit>& rdv(*rdvh);
+  const size_t nchannels = rdv.size();
+  std::cerr << "LazyFrameSource: got " << nchannels << " raw::RawDigit objects\n";
+
+  // Traces refer to the art-owned raw::RawDigit and convert on first
+  // read.  This is safe across threads but the frame must not be
+  // kept past this event.
+  WireCell::ITrace::vector traces(nchannels);
+  if (m_block_size > 1) {
+    for (size_t first = 0; first < nchannels; first += m_block_size) {
+      const size_t nblock = std::min<size_t>(m_block_size, nchannels - first);
+      auto block = std::make_shared<LazyBlock>(&rdv[first], nblock, m_nticks, window);
+      for (size_t ind = 0; ind < nblock; ++ind) {
+        traces[first + ind] = std::make_shared<LazyTrace>(block, ind);
+      }
+    }
+  }
+  else {
+    for (size_t ind = 0; ind < nchannels; ++ind) {
+      traces[ind] = std::make_shared<RawTrace>(rdv[ind], m_nticks, window.first, window.second);
+    }
+  }
 
-  std::cerr << "LazyFrameSource: got " << rdvh->size() << " raw::RawDigit objects\n";
-
-  m_frames.push_back(std::make_shared<LazyFrame>(rdvh, event.event(), time, tick, m_frame_tags));
+  auto sframe = new SimpleFrame(event.event(), time, traces, tick);
+  for (auto tag : m_frame_tags) {
+    sframe->tag_frame(tag);
+  }
+  if (!m_trace_tags.empty()) {
+    IFrame::trace_list_t indices(nchannels);
+    std::iota(indices.begin(), indices.end(), 0);
+    for (auto tag : m_trace_tags) {
+      sframe->tag_traces(tag, indices);
+    }
+  }
+  m_frames.push_back(WireCell::IFrame::pointer(sframe));
   m_frames.push_back(nullptr);
 }
 
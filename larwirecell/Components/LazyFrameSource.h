@@ -4,7 +4,9 @@
  * Lazy means that there is a delay between conversion of the short
  * int samples of the raw::RawDigit and the float samples of
  * IFrame/ITrace.  This can help memory usage if a subset of the
- * frame is processed serially.
+ * frame is processed serially.  Conversion is thread safe, either
+ * per channel or in blocks of channels, and honors nticks as does
+ * RawFrameSource.
  */
 
 #ifndef LARWIRECELL_COMPONENTS_LAZYFRAMESOURCE
@@ -12,11 +14,15 @@
 
 #include "WireCellIface/IConfigurable.h"
 #include "WireCellIface/IFrameSource.h"
+#include "CropWindow.h"
 #include "larwirecell/Interfaces/IArtEventVisitor.h"
 
+#include "art/Framework/Core/ConsumesCollector.h"
 #include "canvas/Utilities/InputTag.h"
+#include "lardataobj/RawData/RawDigit.h"
 
 #include <deque>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -29,6 +35,7 @@ namespace wcls {
     virtual ~LazyFrameSource();
 
     /// IArtEventVisitor
+    virtual void consumes(art::ConsumesCollector& collector);
     virtual void visit(art::Event& event);
 
     /// IFrameSource
@@ -41,9 +48,13 @@ namespace wcls {
   private:
     std::deque<WireCell::IFrame::pointer> m_frames;
     art::InputTag m_inputTag;
+    std::optional<art::ProductToken<std::vector<raw::RawDigit>>> m_token;
     double m_tick;
     int m_nticks;
+    int m_block_size{0};
     std::vector<std::string> m_frame_tags;
+    std::vector<std::string> m_trace_tags;
+    CropWindow m_crop;
   };
 
 }
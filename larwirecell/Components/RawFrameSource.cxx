@@ -1,4 +1,6 @@
 #include "RawFrameSource.h"
+#include "RawTrace.h"
+#include "WaveformPool.h"
 #include "art/Framework/Principal/Handle.h"
 
 // for tick
@@ -10,9 +12,15 @@
 #include "TTimeStamp.h"
 
 #include "WireCellAux/SimpleFrame.h"
-#include "WireCellAux/SimpleTrace.h"
+#include "WireCellIface/IAnodePlane.h"
 #include "WireCellUtil/NamedFactory.h"
 
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
+#include <numeric>
+#include <unordered_set>
+
 WIRECELL_FACTORY(wclsRawFrameSource,
                  wcls::RawFrameSource,
                  wcls::IArtEventVisitor,
@@ -21,7 +29,6 @@ WIRECELL_FACTORY(wclsRawFrameSource,
 using namespace wcls;
 using namespace WireCell;
 using WireCell::Aux::SimpleFrame;
-using WireCell::Aux::SimpleTrace;
 
 RawFrameSource::RawFrameSource() : m_nticks(0) {}
 
@@ -30,26 +37,103 @@ RawFrameSource::~RawFrameSource() {}
 WireCell::Configuration RawFrameSource::default_configuration() const
 {
   Configuration cfg;
-  cfg["art_tag"] = ""; // how to look up the raw digits
+  cfg["art_tag"] = ""; // how to look up the raw digits, may be a list
   cfg["tick"] = 0.5 * WireCell::units::us;
   cfg["frame_tags"][0] = "orig"; // the tags to apply to this frame
   cfg["nticks"] = m_nticks; // if nonzero, truncate or baseline-pad frame to this number of ticks.
+  // If true, traces view the art-owned ADCs and convert to float
+  // only when first read.  The frame must not outlive the event.
+  cfg["lazy"] = m_lazy;
+  // If true, build traces over channels in parallel with TBB using
+  // blocks of grain_size channels.
+  cfg["parallel"] = m_parallel;
+  cfg["grain_size"] = m_grain_size;
+  // If true, recycle waveform buffers of released frames, keeping
+  // at most buffer_pool_mb MB of them idle (zero for no limit).
+  cfg["buffer_pool"] = false;
+  cfg["buffer_pool_mb"] = 1024;
+  // If given, a list of IAnodePlane type:name.  One frame per anode
+  // holding only its channels is produced, in this order, each
+  // additionally tagged "anode<ident>".  Channels of no listed
+  // anode are dropped.
+  cfg["anodes"] = Json::arrayValue;
+  // If nonzero, emit the readout as a sequence of frames, each
+  // slice_nticks long and sharing slice_overlap ticks with the one
+  // before.  Slices are made one at a time as they are pulled so
+  // only one is held at once.  Frame time gives the slice start and
+  // "lazy" does not apply.
+  cfg["slice_nticks"] = m_slice_nticks;
+  cfg["slice_overlap"] = m_slice_overlap;
+  // If given, compute per-trace ADC statistics while converting and
+  // save them as trace summaries under tags made by appending
+  // "baseline" (most frequent), "rms", "min", "max" and "nsat" (count
+  // at or above saturation) to stats_tag.  This implies not lazy.
+  cfg["stats_tag"] = m_stats_tag;
+  cfg["saturation"] = m_saturation;
+  // Optional crop window, see CropWindow.  Slices cover the window.
+  m_crop.default_configuration(cfg);
   return cfg;
 }
 
 void RawFrameSource::configure(const WireCell::Configuration& cfg)
 {
-  const std::string art_tag = cfg["art_tag"].asString();
-  if (art_tag.empty()) {
+  // One frame is made from the union of all labeled collections.
+  m_inputTags.clear();
+  auto jtags = cfg["art_tag"];
+  if (jtags.isString()) {
+    Json::Value one(Json::arrayValue);
+    one.append(jtags);
+    jtags = one;
+  }
+  for (auto jtag : jtags) {
+    const std::string art_tag = jtag.asString();
+    if (art_tag.empty()) { continue; }
+    m_inputTags.push_back(art_tag);
+  }
+  if (m_inputTags.empty()) {
     THROW(ValueError() << errmsg{"WireCell::RawFrameSource requires a source_label"});
   }
-  m_inputTag = cfg["art_tag"].asString();
 
   m_tick = cfg["tick"].asDouble();
   for (auto jtag : cfg["frame_tags"]) {
     m_frame_tags.push_back(jtag.asString());
   }
   m_nticks = get(cfg, "nticks", m_nticks);
+  m_lazy = get(cfg, "lazy", m_lazy);
+  m_parallel = get(cfg, "parallel", m_parallel);
+  m_grain_size = std::max(1, get(cfg, "grain_size", m_grain_size));
+  m_pool.reset();
+  if (get(cfg, "buffer_pool", false)) {
+    const size_t max_mb = std::max(0, get(cfg, "buffer_pool_mb", 1024));
+    m_pool = std::make_shared<WaveformPool>(max_mb << 20);
+  }
+
+  m_slice_nticks = std::max(0, get(cfg, "slice_nticks", m_slice_nticks));
+  m_slice_overlap = std::max(0, get(cfg, "slice_overlap", m_slice_overlap));
+  if (m_slice_nticks and m_slice_overlap >= m_slice_nticks) {
+    THROW(ValueError() << errmsg{"WireCell::RawFrameSource slice_overlap must be less than "
+                                 "slice_nticks"});
+  }
+
+  m_stats_tag = get(cfg, "stats_tag", m_stats_tag);
+  m_saturation = get(cfg, "saturation", m_saturation);
+  m_crop.configure(cfg);
+
+  m_anode_idents.clear();
+  m_chan2anode.clear();
+  for (auto janode : cfg["anodes"]) {
+    const std::string anode_tn = janode.asString();
+    auto anode = Factory::find_tn<IAnodePlane>(anode_tn);
+    const size_t ianode = m_anode_idents.size();
+    m_anode_idents.push_back(anode->ident());
+    for (int chid : anode->channels()) {
+      auto it = m_chan2anode.emplace(chid, ianode).first;
+      if (it->second != ianode) {
+        THROW(ValueError() << errmsg{"WireCell::RawFrameSource channel " + std::to_string(chid) +
+                                     " is in more than one anode"});
+      }
+    }
+  }
 }
 
 // is this the right way to diff an art::Timestamp?
@@ -60,79 +144,222 @@ static double tdiff(const art::Timestamp& ts1, const art::Timestamp& ts2)
   return tts2.AsDouble() - tts1.AsDouble();
 }
 
-static SimpleTrace* make_trace(const raw::RawDigit& rd, unsigned int nticks_want)
+void RawFrameSource::consumes(art::ConsumesCollector& collector)
 {
-  const int chid = rd.Channel();
-  const int tbin = 0;
-  const raw::RawDigit::ADCvector_t& adcv = rd.ADCs();
+  m_tokens.clear();
+  for (const auto& tag : m_inputTags) {
+    m_tokens.push_back(collector.consumes<std::vector<raw::RawDigit>>(tag));
+  }
+}
 
-  short baseline = 0;
-  unsigned int nadcs = adcv.size();
-  if (nticks_want > 0) { // don't want natural input size
-    if (nticks_want > nadcs) { baseline = Waveform::most_frequent(adcv); }
-    nadcs = std::min(nadcs, nticks_want);
+void RawFrameSource::visit(art::Event& event)
+{
+  // Collect digits from all collections.  A channel seen again in a
+  // later collection is dropped.
+  std::vector<const raw::RawDigit*> rdv;
+  std::unordered_set<raw::ChannelID_t> seen;
+  size_t nduplicates = 0;
+  for (size_t itag = 0; itag < m_inputTags.size(); ++itag) {
+    const auto& tag = m_inputTags[itag];
+    art::Handle<std::vector<raw::RawDigit>> rdvh;
+    bool okay = itag < m_tokens.size() ? event.getByToken(m_tokens[itag], rdvh) :
+                                         event.getByLabel(tag, rdvh);
+    if (!okay) {
+      std::string msg =
+        "WireCell::RawFrameSource failed to get vector<raw::RawDigit>: " + tag.encode();
+      std::cerr << msg << std::endl;
+      THROW(RuntimeError() << errmsg{msg});
+    }
+    rdv.reserve(rdv.size() + rdvh->size());
+    for (const auto& rd : *rdvh) {
+      if (m_inputTags.size() > 1 and !seen.insert(rd.Channel()).second) {
+        ++nduplicates;
+        continue;
+      }
+      rdv.push_back(&rd);
+    }
+  }
+  if (nduplicates) {
+    std::cerr << "RawFrameSource: warning: dropped " << nduplicates
+              << " raw::RawDigit objects with duplicate channels\n";
+  }
+  if (rdv.empty()) return;
+
+  const size_t nchannels = rdv.size();
+  std::cerr << "RawFrameSource: got " << nchannels << " raw::RawDigit objects\n";
+
+  if (m_nticks) {
+    std::cerr << "\tinput nticks=" << rdv.front()->Samples() << " setting to " << m_nticks
+              << std::endl;
   }
   else {
-    nticks_want = nadcs;
+    std::cerr << "\tinput nticks=" << rdv.front()->Samples() << " keeping as is" << std::endl;
   }
 
-  auto strace = new SimpleTrace(chid, tbin, nticks_want);
-  for (unsigned int itick = 0; itick < nadcs; ++itick) {
-    strace->charge()[itick] = adcv[itick];
+  // Input indices in output order and where each frame starts in
+  // it.  Without anodes this is the input order and one frame.
+  std::vector<size_t> order;
+  std::vector<size_t> offsets{0};
+  if (m_anode_idents.empty()) {
+    order.resize(nchannels);
+    std::iota(order.begin(), order.end(), 0);
+    offsets.push_back(nchannels);
   }
-  for (unsigned int itick = nadcs; itick < nticks_want; ++itick) {
-    strace->charge()[itick] = baseline;
+  else {
+    const size_t nanodes = m_anode_idents.size();
+    std::vector<size_t> which(nchannels, nanodes);
+    std::vector<size_t> counts(nanodes, 0);
+    for (size_t ind = 0; ind < nchannels; ++ind) {
+      auto it = m_chan2anode.find(rdv[ind]->Channel());
+      if (it == m_chan2anode.end()) { continue; }
+      which[ind] = it->second;
+      ++counts[it->second];
+    }
+    for (size_t ianode = 0; ianode < nanodes; ++ianode) {
+      offsets.push_back(offsets.back() + counts[ianode]);
+    }
+    order.resize(offsets.back());
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t ind = 0; ind < nchannels; ++ind) {
+      if (which[ind] < nanodes) { order[fill[which[ind]]++] = ind; }
+    }
+    if (order.size() < nchannels) {
+      std::cerr << "RawFrameSource: dropping " << nchannels - order.size()
+                << " channels not in any anode\n";
+    }
   }
-  return strace;
-}
 
-void RawFrameSource::visit(art::Event& event)
-{
-  // fixme: want to avoid depending on DetectorPropertiesService for now.
-  const double tick = m_tick;
-  art::Handle<std::vector<raw::RawDigit>> rdvh;
-  bool okay = event.getByLabel(m_inputTag, rdvh);
-  if (!okay) {
-    std::string msg =
-      "WireCell::RawFrameSource failed to get vector<raw::RawDigit>: " + m_inputTag.encode();
-    std::cerr << msg << std::endl;
-    THROW(RuntimeError() << errmsg{msg});
-  }
-  else if (rdvh->size() == 0)
+  const double time = tdiff(event.getRun().beginTime(), event.time());
+  const auto [cbeg, cend] = m_crop.range(event);
+
+  if (m_slice_nticks > 0) {
+    // Slices are made on demand as frames are pulled.
+    if (!m_slicer.rdv.empty()) {
+      std::cerr << "RawFrameSource: dropping unfinished slices of prior event\n";
+    }
+    m_frames.clear();
+    const size_t nticks = std::min<size_t>(m_nticks ? m_nticks : rdv.front()->Samples(), cend);
+    m_slicer = Slicer{std::move(rdv), {}, std::move(order), std::move(offsets), event.event(),
+                      time, nticks, cbeg};
+    m_slicer.adcs.resize(m_slicer.rdv.size());
     return;
+  }
 
-  const std::vector<raw::RawDigit>& rdv(*rdvh);
-  const size_t nchannels = rdv.size();
-  std::cerr << "RawFrameSource: got " << nchannels << " raw::RawDigit objects\n";
+  make_frames(rdv, nullptr, order, offsets, event.event(), time, cbeg, cend, false);
+  m_frames.push_back(nullptr);
+}
 
-  WireCell::ITrace::vector traces(nchannels);
-  for (size_t ind = 0; ind < nchannels; ++ind) {
-    auto const& rd = rdv.at(ind);
-    traces[ind] = ITrace::pointer(make_trace(rd, m_nticks));
-    if (!ind) {
-      if (m_nticks) {
-        std::cerr << "\tinput nticks=" << rd.ADCs().size() << " setting to " << m_nticks
-                  << std::endl;
+void RawFrameSource::make_frames(const std::vector<const raw::RawDigit*>& rdv,
+                                 std::vector<raw::RawDigit::ADCvector_t>* adcs,
+                                 const std::vector<size_t>& order,
+                                 const std::vector<size_t>& offsets,
+                                 int ident,
+                                 double time,
+                                 size_t tbeg,
+                                 size_t tend,
+                                 bool sliced)
+{
+  const bool want_stats = !m_stats_tag.empty();
+  // A slice starts its own frame while a crop keeps the readout time.
+  const int tbin = sliced ? 0 : tbeg;
+  const double ftime = sliced ? time + tbeg * m_tick : time;
+
+  // Each channel fills its own slot so the order is kept.
+  WireCell::ITrace::vector traces(order.size());
+  std::vector<adc::Stats> stats(want_stats ? order.size() : 0);
+  auto build = [&](const tbb::blocked_range<size_t>& range) {
+    for (size_t ind = range.begin(); ind != range.end(); ++ind) {
+      auto const& rd = *rdv[order[ind]];
+      if (m_lazy and !sliced and !want_stats) {
+        traces[ind] = std::make_shared<RawTrace>(rd, m_nticks, tbeg, tend);
+        continue;
+      }
+      // Take a buffer of the length raw_to_charge() will make.
+      const size_t nticks = m_nticks ? m_nticks : rd.Samples();
+      const size_t end = std::min(tend, nticks);
+      auto trace =
+        std::make_shared<PooledTrace>(m_pool, rd.Channel(), tbin, end - std::min(tbeg, end));
+      if (adcs and rd.Compression() != raw::kNone) {
+        // Each index is seen by one thread so the decoding is not shared.
+        auto& adcv = (*adcs)[order[ind]];
+        if (adcv.empty()) { uncompress(rd, adcv); }
+        if (want_stats) {
+          stats[ind] =
+            raw_to_charge_stats(adcv, m_nticks, tbeg, tend, m_saturation, trace->charge());
+        }
+        else {
+          raw_to_charge(adcv, m_nticks, tbeg, tend, trace->charge());
+        }
+      }
+      else if (want_stats) {
+        stats[ind] = raw_to_charge_stats(rd, m_nticks, tbeg, tend, m_saturation, trace->charge());
       }
       else {
-        std::cerr << "\tinput nticks=" << rd.ADCs().size() << " keeping as is" << std::endl;
+        raw_to_charge(rd, m_nticks, tbeg, tend, trace->charge());
       }
+      traces[ind] = trace;
     }
+  };
+  if (m_parallel) {
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, traces.size(), m_grain_size), build);
+  }
+  else {
+    build(tbb::blocked_range<size_t>(0, traces.size()));
   }
 
-  const double time = tdiff(event.getRun().beginTime(), event.time());
-  auto sframe = new SimpleFrame(event.event(), time, traces, tick);
-  for (auto tag : m_frame_tags) {
-    //std::cerr << "\ttagged: " << tag << std::endl;
-    sframe->tag_frame(tag);
+  // fixme: want to avoid depending on DetectorPropertiesService for now.
+  const double tick = m_tick;
+  for (size_t iframe = 0; iframe + 1 < offsets.size(); ++iframe) {
+    ITrace::vector ftraces(traces.begin() + offsets[iframe], traces.begin() + offsets[iframe + 1]);
+    auto sframe = new SimpleFrame(ident, ftime, ftraces, tick);
+    for (auto tag : m_frame_tags) {
+      //std::cerr << "\ttagged: " << tag << std::endl;
+      sframe->tag_frame(tag);
+    }
+    if (!m_anode_idents.empty()) {
+      sframe->tag_frame("anode" + std::to_string(m_anode_idents[iframe]));
+    }
+    if (want_stats) {
+      const size_t ntraces = ftraces.size();
+      IFrame::trace_list_t indices(ntraces);
+      std::iota(indices.begin(), indices.end(), 0);
+      IFrame::trace_summary_t baseline(ntraces), rms(ntraces), smin(ntraces), smax(ntraces),
+        nsat(ntraces);
+      for (size_t ind = 0; ind < ntraces; ++ind) {
+        const auto& st = stats[offsets[iframe] + ind];
+        baseline[ind] = st.baseline;
+        rms[ind] = st.rms;
+        smin[ind] = st.min;
+        smax[ind] = st.max;
+        nsat[ind] = st.nsat;
+      }
+      sframe->tag_traces(m_stats_tag + "baseline", indices, baseline);
+      sframe->tag_traces(m_stats_tag + "rms", indices, rms);
+      sframe->tag_traces(m_stats_tag + "min", indices, smin);
+      sframe->tag_traces(m_stats_tag + "max", indices, smax);
+      sframe->tag_traces(m_stats_tag + "nsat", indices, nsat);
+    }
+    m_frames.push_back(WireCell::IFrame::pointer(sframe));
   }
-  m_frames.push_back(WireCell::IFrame::pointer(sframe));
-  m_frames.push_back(nullptr);
+}
+
+void RawFrameSource::next_slice()
+{
+  auto& sl = m_slicer;
+  const size_t tend = std::min<size_t>(sl.start + m_slice_nticks, sl.nticks);
+  make_frames(sl.rdv, &sl.adcs, sl.order, sl.offsets, sl.ident, sl.time, sl.start, tend, true);
+  if (tend >= sl.nticks) {
+    m_frames.push_back(nullptr);
+    sl = Slicer{};
+    return;
+  }
+  sl.start = tend - m_slice_overlap;
 }
 
 bool RawFrameSource::operator()(WireCell::IFrame::pointer& frame)
 {
   frame = nullptr;
+  if (m_frames.empty() and !m_slicer.rdv.empty()) { next_slice(); }
   if (m_frames.empty()) { return false; }
   frame = m_frames.front();
   m_frames.pop_front();
@@ -2,7 +2,16 @@
  * by also being an art::Event visitor.
  *
  * Raw means that the waveforms are taken from the art::Event as a
- * labeled std::vector<raw::RawDigit> collection.
+ * labeled std::vector<raw::RawDigit> collection, or several which
+ * are merged into one frame.
+ *
+ * Given a list of anodes, one frame per anode is produced instead of
+ * one frame for all channels.  Configuring one source per anode with
+ * a single-element list gives each per-anode pipeline its own input
+ * without a separate frame splitting stage.
+ *
+ * Long readouts may be emitted as a sequence of overlapping time
+ * slices.  The wclsFrameSaver "stitch" option puts them back together.
  */
 
 #ifndef LARWIRECELL_COMPONENTS_RAWFRAMESOURCE
@@ -10,15 +19,22 @@
 
 #include "WireCellIface/IConfigurable.h"
 #include "WireCellIface/IFrameSource.h"
+#include "CropWindow.h"
 #include "larwirecell/Interfaces/IArtEventVisitor.h"
 
+#include "art/Framework/Core/ConsumesCollector.h"
 #include "canvas/Utilities/InputTag.h"
+#include "lardataobj/RawData/RawDigit.h"
 
 #include <deque>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace wcls {
+  class WaveformPool;
+
   class RawFrameSource : public IArtEventVisitor,
                          public WireCell::IFrameSource,
                          public WireCell::IConfigurable {
@@ -27,6 +43,7 @@ namespace wcls {
     virtual ~RawFrameSource();
 
     /// IArtEventVisitor
+    virtual void consumes(art::ConsumesCollector& collector);
     virtual void visit(art::Event& event);
 
     /// IFrameSource
@@ -38,10 +55,55 @@ namespace wcls {
 
   private:
     std::deque<WireCell::IFrame::pointer> m_frames;
-    art::InputTag m_inputTag;
+    std::vector<art::InputTag> m_inputTags;
+    std::vector<art::ProductToken<std::vector<raw::RawDigit>>> m_tokens;
     double m_tick;
     int m_nticks;
+    bool m_parallel{false};
+    int m_grain_size{64};
+    std::shared_ptr<WaveformPool> m_pool;
+
+    // Optional split of the frame by anode.
+    std::vector<int> m_anode_idents;
+    std::unordered_map<int, size_t> m_chan2anode;
+    bool m_lazy{false};
     std::vector<std::string> m_frame_tags;
+
+    // Optional per-trace statistics saved as trace summaries.
+    std::string m_stats_tag{""};
+    int m_saturation{4095};
+
+    CropWindow m_crop;
+
+    // Optional time slicing.  The slicer holds what is needed to
+    // make the remaining slices of the current event.  Compressed
+    // digits are decoded by the first slice into adcs, by index in
+    // rdv, and later slices read from there.
+    int m_slice_nticks{0}, m_slice_overlap{0};
+    struct Slicer {
+      std::vector<const raw::RawDigit*> rdv;
+      std::vector<raw::RawDigit::ADCvector_t> adcs;
+      std::vector<size_t> order, offsets;
+      int ident{0};
+      double time{0};
+      size_t nticks{0}, start{0};
+    };
+    Slicer m_slicer;
+
+    // Make one frame per group of order given by offsets from ticks
+    // [tbeg, tend).  Slices have tbin 0 and time moved to tbeg, else
+    // tbin is tbeg.  If adcs is given, compressed digits are decoded
+    // into it once and read from there.
+    void make_frames(const std::vector<const raw::RawDigit*>& rdv,
+                     std::vector<raw::RawDigit::ADCvector_t>* adcs,
+                     const std::vector<size_t>& order,
+                     const std::vector<size_t>& offsets,
+                     int ident,
+                     double time,
+                     size_t tbeg,
+                     size_t tend,
+                     bool sliced);
+    void next_slice();
   };
 
 }
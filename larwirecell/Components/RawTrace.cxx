@@ -0,0 +1,134 @@
+#include "RawTrace.h"
+#include "AdcConvert.h"
+
+#include "lardataobj/RawData/raw.h"
+
+#include <algorithm>
+
+using namespace wcls;
+using WireCell::ITrace;
+
+// Fill charge with ticks [tbeg, tend) of the ADCs after they are
+// truncated or padded to nticks.
+static void convert_span(const raw::RawDigit::ADCvector_t& adcv,
+                         size_t nticks,
+                         size_t tbeg,
+                         size_t tend,
+                         ITrace::ChargeSequence& charge,
+                         adc::Stats* stats = nullptr,
+                         short saturation = 0)
+{
+  const size_t nadcs = adcv.size();
+  if (!nticks) { nticks = nadcs; }
+  tend = std::min(tend, nticks);
+  tbeg = std::min(tbeg, tend);
+
+  short baseline = 0;
+  if (tend > nadcs) { baseline = WireCell::Waveform::most_frequent(adcv); }
+  const size_t nin = nadcs > tbeg ? std::min(nadcs, tend) - tbeg : 0;
+
+  charge.resize(tend - tbeg);
+  if (stats) {
+    *stats =
+      adc::convert_stats(adcv.data() + tbeg, nin, charge.data(), charge.size(), baseline, saturation);
+    return;
+  }
+  adc::convert(adcv.data() + tbeg, nin, charge.data(), charge.size(), baseline);
+}
+
+// Return the uncompressed ADCs, decoding if needed into per-thread
+// scratch which keeps its capacity so that no uncompressed copy is
+// allocated per channel.
+static const raw::RawDigit::ADCvector_t& uncompressed(const raw::RawDigit& rd)
+{
+  if (rd.Compression() == raw::kNone) { return rd.ADCs(); }
+  thread_local raw::RawDigit::ADCvector_t scratch;
+  uncompress(rd, scratch);
+  return scratch;
+}
+
+void wcls::uncompress(const raw::RawDigit& rd, raw::RawDigit::ADCvector_t& adcv)
+{
+  adcv.resize(rd.Samples());
+  raw::Uncompress(rd.ADCs(), adcv, rd.GetPedestal(), rd.Compression());
+}
+
+void wcls::raw_to_charge(const raw::RawDigit::ADCvector_t& adcv,
+                         unsigned int nticks,
+                         ITrace::ChargeSequence& charge)
+{
+  convert_span(adcv, nticks, 0, adcv.size() + nticks, charge);
+}
+
+void wcls::raw_to_charge(const raw::RawDigit& rd,
+                         unsigned int nticks,
+                         ITrace::ChargeSequence& charge)
+{
+  const auto& adcv = uncompressed(rd);
+  convert_span(adcv, nticks, 0, adcv.size() + nticks, charge);
+}
+
+void wcls::raw_to_charge(const raw::RawDigit& rd,
+                         unsigned int nticks,
+                         size_t tbeg,
+                         size_t tend,
+                         ITrace::ChargeSequence& charge)
+{
+  convert_span(uncompressed(rd), nticks, tbeg, tend, charge);
+}
+
+adc::Stats wcls::raw_to_charge_stats(const raw::RawDigit& rd,
+                                     unsigned int nticks,
+                                     size_t tbeg,
+                                     size_t tend,
+                                     short saturation,
+                                     ITrace::ChargeSequence& charge)
+{
+  adc::Stats stats;
+  convert_span(uncompressed(rd), nticks, tbeg, tend, charge, &stats, saturation);
+  return stats;
+}
+
+void wcls::raw_to_charge(const raw::RawDigit::ADCvector_t& adcv,
+                         unsigned int nticks,
+                         size_t tbeg,
+                         size_t tend,
+                         ITrace::ChargeSequence& charge)
+{
+  convert_span(adcv, nticks, tbeg, tend, charge);
+}
+
+adc::Stats wcls::raw_to_charge_stats(const raw::RawDigit::ADCvector_t& adcv,
+                                     unsigned int nticks,
+                                     size_t tbeg,
+                                     size_t tend,
+                                     short saturation,
+                                     ITrace::ChargeSequence& charge)
+{
+  adc::Stats stats;
+  convert_span(adcv, nticks, tbeg, tend, charge, &stats, saturation);
+  return stats;
+}
+
+RawTrace::RawTrace(const raw::RawDigit& rd, unsigned int nticks, size_t tbeg, size_t tend)
+  : m_rd(&rd), m_channel(rd.Channel()), m_nticks(nticks), m_tbeg(tbeg), m_tend(tend)
+{}
+
+RawTrace::~RawTrace() {}
+
+int RawTrace::channel() const
+{
+  return m_channel;
+}
+
+int RawTrace::tbin() const
+{
+  return m_tbeg;
+}
+
+const ITrace::ChargeSequence& RawTrace::charge() const
+{
+  // Several WCT nodes may read the same trace concurrently.
+  std::call_once(m_once, [this]() { raw_to_charge(*m_rd, m_nticks, m_tbeg, m_tend, m_charge); });
+  return m_charge;
+}
@@ -0,0 +1,98 @@
+/** An ITrace which is a view onto a raw::RawDigit.
+ *
+ * The short int ADC samples are held by reference to the art-owned
+ * raw::RawDigit and are decoded, if compressed, and converted to the
+ * float charge sequence only on the first call to charge().  Traces
+ * which are never read never cost their float storage.
+ *
+ * The raw::RawDigit must outlive the trace.  In practice this means
+ * the frame holding these traces must not be kept past the
+ * art::Event it came from.
+ */
+
+#ifndef LARWIRECELL_COMPONENTS_RAWTRACE
+#define LARWIRECELL_COMPONENTS_RAWTRACE
+
+#include "AdcConvert.h"
+#include "WireCellIface/ITrace.h"
+#include "lardataobj/RawData/RawDigit.h"
+
+#include <cstddef>
+#include <limits>
+#include <mutex>
+
+namespace wcls {
+
+  /// Fill charge from ADC samples.  If nticks is nonzero the result
+  /// is truncated or padded with the most frequent ADC value to
+  /// exactly that many ticks, else the natural size is kept.
+  void raw_to_charge(const raw::RawDigit::ADCvector_t& adcv,
+                     unsigned int nticks,
+                     WireCell::ITrace::ChargeSequence& charge);
+
+  /// As above but taking the samples from the raw::RawDigit which
+  /// are first decoded if the digit is compressed.
+  void raw_to_charge(const raw::RawDigit& rd,
+                     unsigned int nticks,
+                     WireCell::ITrace::ChargeSequence& charge);
+
+  /// As above but keeping only ticks [tbeg, tend) of the result.
+  void raw_to_charge(const raw::RawDigit& rd,
+                     unsigned int nticks,
+                     size_t tbeg,
+                     size_t tend,
+                     WireCell::ITrace::ChargeSequence& charge);
+
+  /// As above but also return statistics of the ADC samples which
+  /// are converted, not counting any padding.
+  adc::Stats raw_to_charge_stats(const raw::RawDigit& rd,
+                                 unsigned int nticks,
+                                 size_t tbeg,
+                                 size_t tend,
+                                 short saturation,
+                                 WireCell::ITrace::ChargeSequence& charge);
+
+  /// As the above two but from ADC samples already decoded.
+  void raw_to_charge(const raw::RawDigit::ADCvector_t& adcv,
+                     unsigned int nticks,
+                     size_t tbeg,
+                     size_t tend,
+                     WireCell::ITrace::ChargeSequence& charge);
+  adc::Stats raw_to_charge_stats(const raw::RawDigit::ADCvector_t& adcv,
+                                 unsigned int nticks,
+                                 size_t tbeg,
+                                 size_t tend,
+                                 short saturation,
+                                 WireCell::ITrace::ChargeSequence& charge);
+
+  /// Decode the ADC samples of a compressed digit.
+  void uncompress(const raw::RawDigit& rd, raw::RawDigit::ADCvector_t& adcv);
+
+  class RawTrace : public WireCell::ITrace {
+  public:
+    /// View ticks [tbeg, tend) of the digit after it is truncated or
+    /// padded to nticks.  The trace tbin is tbeg.
+    RawTrace(const raw::RawDigit& rd,
+             unsigned int nticks = 0,
+             size_t tbeg = 0,
+             size_t tend = std::numeric_limits<size_t>::max());
+    virtual ~RawTrace();
+
+    /// ITrace
+    virtual int channel() const;
+    virtual int tbin() const;
+    virtual const ChargeSequence& charge() const;
+
+  private:
+    const raw::RawDigit* m_rd;
+    int m_channel;
+    unsigned int m_nticks;
+    size_t m_tbeg, m_tend;
+
+    mutable std::once_flag m_once;
+    mutable ChargeSequence m_charge;
+  };
+
+}
+
+#endif
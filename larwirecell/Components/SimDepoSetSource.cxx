@@ -169,11 +169,19 @@ void SimDepoSetSource::configure(const WireCell::Configuration& cfg)
   m_debug_file = get(cfg, "debug_file", m_debug_file);
 }
 
+void SimDepoSetSource::consumes(art::ConsumesCollector& collector)
+{
+  m_token = collector.consumes<std::vector<sim::SimEnergyDeposit>>(m_inputTag);
+  if (m_assnTag != "") {
+    m_assnToken = collector.consumes<std::vector<sim::SimEnergyDeposit>>(m_assnTag);
+  }
+}
+
 void SimDepoSetSource::visit(art::Event& event)
 {
   art::Handle<std::vector<sim::SimEnergyDeposit>> sedvh;
 
-  bool okay = event.getByLabel(m_inputTag, sedvh);
+  bool okay = m_token ? event.getByToken(*m_token, sedvh) : event.getByLabel(m_inputTag, sedvh);
   if (!okay) {
     std::string msg =
       "SimDepoSetSource failed to get sim::SimEnergyDeposit from art tag: " + m_inputTag.encode();
@@ -197,7 +205,8 @@ void SimDepoSetSource::visit(art::Event& event)
   std::vector<sim::SimEnergyDeposit> assn_sedv;
   if (m_assnTag != "") {
     art::Handle<std::vector<sim::SimEnergyDeposit>> assn_sedvh;
-    okay = event.getByLabel(m_assnTag, assn_sedvh);
+    okay = m_assnToken ? event.getByToken(*m_assnToken, assn_sedvh) :
+                         event.getByLabel(m_assnTag, assn_sedvh);
     if (!okay) {
       std::string msg =
         "SimDepoSetSource failed to get sim::SimEnergyDeposit from art tag: " + m_assnTag.encode();
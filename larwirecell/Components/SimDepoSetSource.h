@@ -8,9 +8,17 @@
 #include "WireCellIface/IConfigurable.h"
 #include "WireCellIface/IDepoSet.h"
 #include "WireCellIface/IDepoSetSource.h"
+#include "art/Framework/Core/ConsumesCollector.h"
 #include "canvas/Utilities/InputTag.h"
 #include "larwirecell/Interfaces/IArtEventVisitor.h"
 
+#include <optional>
+#include <vector>
+
+namespace sim {
+  class SimEnergyDeposit;
+}
+
 namespace wcls {
 
   class SimDepoSetSource : public IArtEventVisitor,
@@ -23,6 +31,7 @@ namespace wcls {
     virtual ~SimDepoSetSource();
 
     /// IArtEventVisitor
+    virtual void consumes(art::ConsumesCollector& collector);
     virtual void visit(art::Event& event);
 
     /// IDepoSetSource
@@ -44,6 +53,9 @@ namespace wcls {
     art::InputTag m_inputTag;
     art::InputTag m_assnTag; // associated input
 
+    using sed_token_t = art::ProductToken<std::vector<sim::SimEnergyDeposit>>;
+    std::optional<sed_token_t> m_token, m_assnToken;
+
     // Config: id_is_track - If false, IDepo::id() stores index into
     // SimEnergyDeposit vector element from which the IDepo was made.
     // If true the IDepo::id() stores the SimEnergyDeposit::TrackID().
@@ -159,11 +159,19 @@ void SimDepoSource::configure(const WireCell::Configuration& cfg)
   m_assnTag = cfg["assn_art_tag"].asString();
 }
 
+void SimDepoSource::consumes(art::ConsumesCollector& collector)
+{
+  m_token = collector.consumes<std::vector<sim::SimEnergyDeposit>>(m_inputTag);
+  if (m_assnTag != "") {
+    m_assnToken = collector.consumes<std::vector<sim::SimEnergyDeposit>>(m_assnTag);
+  }
+}
+
 void SimDepoSource::visit(art::Event& event)
 {
   art::Handle<std::vector<sim::SimEnergyDeposit>> sedvh;
 
-  bool okay = event.getByLabel(m_inputTag, sedvh);
+  bool okay = m_token ? event.getByToken(*m_token, sedvh) : event.getByLabel(m_inputTag, sedvh);
   if (!okay) {
     std::string msg =
       "SimDepoSource failed to get sim::SimEnergyDeposit from art tag: " + m_inputTag.encode();
@@ -186,7 +194,8 @@ void SimDepoSource::visit(art::Event& event)
   std::vector<sim::SimEnergyDeposit> assn_sedv;
   if (m_assnTag != "") {
     art::Handle<std::vector<sim::SimEnergyDeposit>> assn_sedvh;
-    okay = event.getByLabel(m_assnTag, assn_sedvh);
+    okay = m_assnToken ? event.getByToken(*m_assnToken, assn_sedvh) :
+                         event.getByLabel(m_assnTag, assn_sedvh);
     if (!okay) {
       std::string msg =
         "SimDepoSource failed to get sim::SimEnergyDeposit from art tag: " + m_assnTag.encode();
@@ -28,10 +28,17 @@
 #include "WireCellIface/IConfigurable.h"
 #include "WireCellIface/IDepo.h"
 #include "WireCellIface/IDepoSource.h"
+#include "art/Framework/Core/ConsumesCollector.h"
 #include "canvas/Utilities/InputTag.h"
 #include "larwirecell/Interfaces/IArtEventVisitor.h"
 
 #include <deque>
+#include <optional>
+#include <vector>
+
+namespace sim {
+  class SimEnergyDeposit;
+}
 
 namespace wcls {
 
@@ -47,6 +54,7 @@ namespace wcls {
     virtual ~SimDepoSource();
 
     /// IArtEventVisitor
+    virtual void consumes(art::ConsumesCollector& collector);
     virtual void visit(art::Event& event);
 
     /// IDepoSource
@@ -62,6 +70,9 @@ namespace wcls {
 
     art::InputTag m_inputTag;
     art::InputTag m_assnTag; // associated input
+
+    using sed_token_t = art::ProductToken<std::vector<sim::SimEnergyDeposit>>;
+    std::optional<sed_token_t> m_token, m_assnToken;
   };
 }
 #endif
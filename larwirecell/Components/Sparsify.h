@@ -0,0 +1,230 @@
+/** Helpers to sparsify dense waveforms into regions of interest.
+ *
+ * Finding runs of nonzero samples is done with AVX2 when the CPU has
+ * it, else with a scalar loop, chosen at run time.  ScaledIterator
+ * lets a run be scaled while it is copied into its final storage,
+ * eg by lar::sparse_vector::add_range(), with no temporary.
+ *
+ * A Policy may instead select ROIs by threshold, drop short ones, pad
+ * them and merge close neighbors.  This is shared by wclsFrameSaver
+ * and the EventButcher module.
+ */
+
+#ifndef LARWIRECELL_COMPONENTS_SPARSIFY
+#define LARWIRECELL_COMPONENTS_SPARSIFY
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define WCLS_SPARSIFY_X86 1
+#include <immintrin.h>
+#endif
+
+namespace wcls {
+  namespace sparsify {
+
+    /// Signature of a search kernel returning the first element in
+    /// [beg, end) which is nonzero (or zero), else end.
+    typedef const float* (*find_t)(const float* beg, const float* end);
+
+    // Note, as with std::find_if, NaN counts as nonzero.
+    inline const float* find_nonzero_scalar(const float* beg, const float* end)
+    {
+      for (; beg < end; ++beg) {
+        if (*beg != 0.0f) { return beg; }
+      }
+      return end;
+    }
+
+    inline const float* find_zero_scalar(const float* beg, const float* end)
+    {
+      for (; beg < end; ++beg) {
+        if (*beg == 0.0f) { return beg; }
+      }
+      return end;
+    }
+
+#ifdef WCLS_SPARSIFY_X86
+    __attribute__((target("avx2"))) inline const float* find_nonzero_avx2(const float* beg,
+                                                                         const float* end)
+    {
+      const __m256 zero = _mm256_setzero_ps();
+      for (; beg + 8 <= end; beg += 8) {
+        const int mask =
+          _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(beg), zero, _CMP_NEQ_UQ));
+        if (mask) { return beg + __builtin_ctz(mask); }
+      }
+      return find_nonzero_scalar(beg, end);
+    }
+
+    __attribute__((target("avx2"))) inline const float* find_zero_avx2(const float* beg,
+                                                                      const float* end)
+    {
+      const __m256 zero = _mm256_setzero_ps();
+      for (; beg + 8 <= end; beg += 8) {
+        const int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(beg), zero, _CMP_EQ_OQ));
+        if (mask) { return beg + __builtin_ctz(mask); }
+      }
+      return find_zero_scalar(beg, end);
+    }
+#endif
+
+    inline bool have_avx2()
+    {
+#ifdef WCLS_SPARSIFY_X86
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#else
+      return false;
+#endif
+    }
+
+    /// Return the first nonzero sample in [beg, end), else end.
+    inline const float* find_nonzero(const float* beg, const float* end)
+    {
+#ifdef WCLS_SPARSIFY_X86
+      static const find_t kernel = have_avx2() ? find_nonzero_avx2 : find_nonzero_scalar;
+#else
+      static const find_t kernel = find_nonzero_scalar;
+#endif
+      return kernel(beg, end);
+    }
+
+    /// Return the first zero sample in [beg, end), else end.
+    inline const float* find_zero(const float* beg, const float* end)
+    {
+#ifdef WCLS_SPARSIFY_X86
+      static const find_t kernel = have_avx2() ? find_zero_avx2 : find_zero_scalar;
+#else
+      static const find_t kernel = find_zero_scalar;
+#endif
+      return kernel(beg, end);
+    }
+
+    /// A forward iterator over samples which yields each multiplied
+    /// by a scale.  The product is formed in double and rounded to
+    /// float, the same as "float x; x *= scale;" with double scale.
+    class ScaledIterator {
+    public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef float value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const float* pointer;
+      typedef float reference;
+
+      ScaledIterator(const float* ptr, double scale) : m_ptr(ptr), m_scale(scale) {}
+
+      float operator*() const { return float(*m_ptr * m_scale); }
+      ScaledIterator& operator++()
+      {
+        ++m_ptr;
+        return *this;
+      }
+      ScaledIterator operator++(int)
+      {
+        ScaledIterator ret(*this);
+        ++m_ptr;
+        return ret;
+      }
+      bool operator==(const ScaledIterator& other) const { return m_ptr == other.m_ptr; }
+      bool operator!=(const ScaledIterator& other) const { return m_ptr != other.m_ptr; }
+
+    private:
+      const float* m_ptr;
+      double m_scale;
+    };
+
+    /// How to select ROIs from a dense waveform.  Samples with a
+    /// magnitude above the threshold seed an ROI.  Thresholds are in
+    /// units of the scaled samples as saved.  Lengths are in ticks.
+    struct Policy {
+      double threshold{0};     // absolute
+      double rel_threshold{0}; // fraction of the peak magnitude of the waveform
+      int min_length{1};       // shorter runs above threshold are dropped
+      int pad_pre{0};          // ticks added before each run
+      int pad_post{0};         // ticks added after each run
+      int merge_gap{0};        // ROIs separated by fewer ticks are merged
+
+      /// True if this selects every run of nonzero samples as is.
+      bool exact() const
+      {
+        return threshold <= 0 && rel_threshold <= 0 && min_length <= 1 && pad_pre <= 0 &&
+               pad_post <= 0 && merge_gap <= 0;
+      }
+    };
+
+    /// Call emit(rbeg, rend) for each ROI in [beg, end) selected by
+    /// the policy, in order and without overlap.  The scale is that
+    /// which will be applied to the samples and is used only to
+    /// express the thresholds in terms of the unscaled samples.
+    /// Padded and merged ROIs include the samples between runs as is.
+    template <typename Emit>
+    void for_each_roi(const float* beg,
+                      const float* end,
+                      const Policy& policy,
+                      double scale,
+                      Emit emit)
+    {
+      if (policy.exact()) {
+        while (true) {
+          beg = find_nonzero(beg, end);
+          if (beg == end) { return; }
+          const float* mid = find_zero(beg, end);
+          emit(beg, mid);
+          beg = mid;
+        }
+      }
+
+      const double ascale = std::abs(scale);
+      double thresh = policy.threshold;
+      if (policy.rel_threshold > 0) {
+        float peak = 0;
+        for (const float* ptr = beg; ptr != end; ++ptr) {
+          peak = std::max(peak, std::abs(*ptr));
+        }
+        thresh = std::max(thresh, policy.rel_threshold * peak * ascale);
+      }
+      const float cut =
+        ascale > 0 ? float(thresh / ascale) : std::numeric_limits<float>::infinity();
+      // As with the exact selection, NaN counts as above.
+      auto above = [cut](float v) { return !(std::abs(v) <= cut); };
+
+      // Negative padding would make reversed ROIs so counts as none.
+      const std::ptrdiff_t nsamples = end - beg;
+      const std::ptrdiff_t pad_pre = std::max(policy.pad_pre, 0);
+      const std::ptrdiff_t pad_post = std::max(policy.pad_post, 0);
+      const std::ptrdiff_t min_gap = std::max(policy.merge_gap, 1);
+      std::ptrdiff_t rbeg = 0, rend = -1; // pending ROI, if rend >= 0
+      std::ptrdiff_t ind = 0;
+      while (ind < nsamples) {
+        while (ind < nsamples && !above(beg[ind])) {
+          ++ind;
+        }
+        if (ind == nsamples) { break; }
+        std::ptrdiff_t jnd = ind;
+        while (jnd < nsamples && above(beg[jnd])) {
+          ++jnd;
+        }
+        if (jnd - ind >= policy.min_length) {
+          const std::ptrdiff_t pbeg = std::max<std::ptrdiff_t>(0, ind - pad_pre);
+          const std::ptrdiff_t pend = std::min<std::ptrdiff_t>(nsamples, jnd + pad_post);
+          if (rend >= 0 && pbeg - rend < min_gap) { rend = pend; }
+          else {
+            if (rend >= 0) { emit(beg + rbeg, beg + rend); }
+            rbeg = pbeg;
+            rend = pend;
+          }
+        }
+        ind = jnd;
+      }
+      if (rend >= 0) { emit(beg + rbeg, beg + rend); }
+    }
+
+  }
+}
+
+#endif
@@ -0,0 +1,100 @@
+#include "WaveformPool.h"
+
+using namespace wcls;
+
+// A thread's free list holds at most this many buffers before half
+// go back to the shared one.  A miss moves up to this many fitting
+// buffers from the shared list.
+static const size_t max_local = 64;
+static const size_t refill = 16;
+
+static size_t nbytes(const WaveformPool::buffer_t& buf)
+{
+  return buf.capacity() * sizeof(WaveformPool::buffer_t::value_type);
+}
+
+WaveformPool::WaveformPool(size_t max_bytes) : m_max_bytes(max_bytes) {}
+
+WaveformPool::buffer_t WaveformPool::take(size_t n)
+{
+  auto& local = m_local.local();
+
+  // Best fit from this thread's buffers, else from the shared ones.
+  size_t best = local.size();
+  for (size_t ind = 0; ind < local.size(); ++ind) {
+    const size_t cap = local[ind].capacity();
+    if (cap >= n && (best == local.size() || cap < local[best].capacity())) { best = ind; }
+  }
+  if (best == local.size()) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_free.lower_bound(n); it != m_free.end() && local.size() < best + refill;) {
+      local.push_back(std::move(it->second));
+      it = m_free.erase(it);
+    }
+  }
+
+  buffer_t buf;
+  if (best < local.size()) {
+    buf = std::move(local[best]);
+    local[best] = std::move(local.back());
+    local.pop_back();
+    m_bytes -= nbytes(buf);
+  }
+  buf.resize(n);
+  return buf;
+}
+
+void WaveformPool::give(buffer_t&& buf)
+{
+  const size_t bytes = nbytes(buf);
+  if (bytes == 0) { return; }
+  if (m_bytes.fetch_add(bytes) + bytes > m_max_bytes && m_max_bytes) {
+    m_bytes -= bytes;
+    buffer_t().swap(buf); // freed
+    return;
+  }
+
+  auto& local = m_local.local();
+  local.push_back(std::move(buf));
+  if (local.size() <= max_local) { return; }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  while (local.size() > max_local / 2) {
+    const size_t cap = local.back().capacity();
+    m_free.emplace(cap, std::move(local.back()));
+    local.pop_back();
+  }
+}
+
+size_t WaveformPool::idle_bytes() const
+{
+  return m_bytes;
+}
+
+PooledTrace::PooledTrace(const std::shared_ptr<WaveformPool>& pool, int chid, int tbin, size_t n)
+  : m_pool(pool), m_chid(chid), m_tbin(tbin), m_charge(pool ? pool->take(n) : ChargeSequence(n))
+{}
+
+PooledTrace::~PooledTrace()
+{
+  if (auto pool = m_pool.lock()) { pool->give(std::move(m_charge)); }
+}
+
+int PooledTrace::channel() const
+{
+  return m_chid;
+}
+
+int PooledTrace::tbin() const
+{
+  return m_tbin;
+}
+
+const WireCell::ITrace::ChargeSequence& PooledTrace::charge() const
+{
+  return m_charge;
+}
+
+WireCell::ITrace::ChargeSequence& PooledTrace::charge()
+{
+  return m_charge;
+}
@@ -0,0 +1,88 @@
+/** A pool of waveform buffers which are recycled across events.
+ *
+ * Frame sources make tens of thousands of charge sequences per event
+ * and drop them all again when the frame is released.  A PooledTrace
+ * takes its charge buffer from a WaveformPool and hands it back when
+ * the trace is destroyed so that, once the pool has grown to the
+ * working set, no waveform storage is allocated on the heap.
+ *
+ * The idle buffers are capped in total size so that one large event
+ * does not pin its working set for the rest of the job.  A buffer is
+ * taken by best fit so short buffers are not grown for long traces.
+ * Each thread keeps a small free list of its own and trades buffers
+ * with the shared one in batches to keep the lock uncontended when
+ * traces are made in parallel.
+ *
+ * Traces hold the pool weakly.  If the owning component goes away
+ * first, buffers are simply freed.  A PooledTrace made without a
+ * pool behaves like a plain SimpleTrace.
+ */
+
+#ifndef LARWIRECELL_COMPONENTS_WAVEFORMPOOL
+#define LARWIRECELL_COMPONENTS_WAVEFORMPOOL
+
+#include "WireCellIface/ITrace.h"
+
+#include "tbb/enumerable_thread_specific.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace wcls {
+
+  class WaveformPool {
+  public:
+    typedef WireCell::ITrace::ChargeSequence buffer_t;
+
+    /// Keep at most max_bytes in idle buffers, zero for no limit.
+    explicit WaveformPool(size_t max_bytes = 0);
+
+    /// Return a buffer of size n.  Its content is unspecified.
+    buffer_t take(size_t n);
+
+    /// Accept a buffer for later reuse or free it if the pool is full.
+    void give(buffer_t&& buf);
+
+    /// Number of bytes currently idle in the pool.
+    size_t idle_bytes() const;
+
+  private:
+    // Buffers idle in one thread, used without locking.
+    typedef std::vector<buffer_t> local_t;
+    tbb::enumerable_thread_specific<local_t> m_local;
+
+    // Buffers shared by all threads, by capacity.
+    std::mutex m_mutex;
+    std::multimap<size_t, buffer_t> m_free;
+
+    const size_t m_max_bytes;
+    std::atomic<size_t> m_bytes{0};
+  };
+
+  class PooledTrace : public WireCell::ITrace {
+  public:
+    /// Make a trace with n samples.  Their values are unspecified
+    /// when taken from a pool and zero otherwise.
+    PooledTrace(const std::shared_ptr<WaveformPool>& pool, int chid, int tbin, size_t n);
+    virtual ~PooledTrace();
+
+    /// ITrace
+    virtual int channel() const;
+    virtual int tbin() const;
+    virtual const ChargeSequence& charge() const;
+
+    /// Access for filling.
+    ChargeSequence& charge();
+
+  private:
+    std::weak_ptr<WaveformPool> m_pool;
+    int m_chid, m_tbin;
+    ChargeSequence m_charge;
+  };
+
+}
+
+#endif
@@ -18,6 +18,9 @@ namespace art {
   class Event;
   class EDProducer;
   class ProducesCollector;
+  class ConsumesCollector;
+  class Run;
+  class SubRun;
 }
 namespace wcls {
   class IArtEventVisitor : public WireCell::IComponent<IArtEventVisitor> {
@@ -29,8 +32,24 @@ namespace wcls {
     /// If only reading data, implementation is not required.
     virtual void produces(art::ProducesCollector& collector) {}
 
+    /// If data is read, implement in order to call:
+    ///   m_token = collector.consumes<DataType>(tag);
+    /// and retrieve the data by the token so that Art may schedule
+    /// and prefetch it.
+    virtual void consumes(art::ConsumesCollector& collector) {}
+
     /// Implement to visit an Art event.
     virtual void visit(art::Event& event) = 0;
+
+    /// Implement to prepare for the events of a run, eg to cache
+    /// information from services which changes at most per run.
+    virtual void beginRun(art::Run const& run) {}
+
+    /// Implement to finish with a run.
+    virtual void endRun(art::Run const& run) {}
+
+    /// Implement to prepare for the events of a subrun.
+    virtual void beginSubRun(art::SubRun const& subrun) {}
   };
 }
 #endif
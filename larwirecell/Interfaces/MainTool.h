@@ -8,9 +8,14 @@
 #ifndef LARWIRECELL_INTERFACES_MAINTOOL
 #define LARWIRECELL_INTERFACES_MAINTOOL
 
+#include <cstddef>
+
 namespace art {
   class Event;
   class ProducesCollector;
+  class ConsumesCollector;
+  class Run;
+  class SubRun;
 }
 
 namespace wcls {
@@ -24,8 +29,24 @@ namespace wcls {
     /// products
     virtual void produces(art::ProducesCollector& collector) = 0;
 
+    /// Accept a consumes collector in order to declare the data
+    /// products which are read.
+    virtual void consumes(art::ConsumesCollector& collector) {}
+
     /// Accept an event to process.
     virtual void process(art::Event& event) = 0;
+
+    /// Return the number of events which process() may be called
+    /// on concurrently.
+    virtual std::size_t concurrency() const { return 1; }
+
+    /// Called once after the last event.
+    virtual void endJob() {}
+
+    /// Called at run and subrun transitions.
+    virtual void beginRun(art::Run const& run) {}
+    virtual void endRun(art::Run const& run) {}
+    virtual void beginSubRun(art::SubRun const& subrun) {}
   };
 }
 
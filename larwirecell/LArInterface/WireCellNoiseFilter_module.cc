@@ -17,6 +17,7 @@
 #include "larevt/CalibrationDBI/Interface/ElectronicsCalibService.h"
 
 #include "lardataobj/RawData/RawDigit.h"
+#include "larwirecell/Components/AdcConvert.h"
 
 #include "WireCellAux/DftTools.h"
 #include "WireCellAux/SimpleFrame.h"
@@ -405,10 +406,7 @@ namespace noisefilteralg {
       WireCell::ITrace::ChargeSequence charges;
 
       charges.resize(nsamples);
-
-      std::transform(rawAdcVec.begin(), rawAdcVec.end(), charges.begin(), [](auto& adcVal) {
-        return float(adcVal);
-      });
+      wcls::adc::convert(rawAdcVec.data(), rawAdcVec.size(), charges.data(), charges.size());
 
       unsigned int chan = inputWaveforms.at(ich).Channel();
       SimpleTrace* st = new SimpleTrace(chan, 0.0, charges);
@@ -8,6 +8,8 @@
 #include "lardataobj/RawData/RawDigit.h"
 #include "lardataobj/RecoBase/Wire.h"
 
+#include "larwirecell/Components/Sparsify.h"
+
 namespace butcher {
 
   struct EventButcherConfig {
@@ -44,6 +46,30 @@ namespace butcher {
       fhicl::Name("sigscale"),
       fhicl::Comment("A multiplicative scale factor applied to the output recob::Wires"),
       1.0};
+
+    // The defaults keep every run of nonzero samples.
+    fhicl::Atom<double> threshold{
+      fhicl::Name("threshold"),
+      fhicl::Comment("Scaled signal magnitude above which a sample seeds an ROI"),
+      0.0};
+    fhicl::Atom<double> rel_threshold{
+      fhicl::Name("rel_threshold"),
+      fhicl::Comment("Fraction of the waveform peak magnitude above which a sample seeds an ROI"),
+      0.0};
+    fhicl::Atom<unsigned int> min_length{
+      fhicl::Name("min_length"),
+      fhicl::Comment("Minimum number of ticks above threshold in an ROI"),
+      1};
+    fhicl::Atom<unsigned int> pad_pre{fhicl::Name("pad_pre"),
+                                      fhicl::Comment("Number of ticks to pad before each ROI"),
+                                      0};
+    fhicl::Atom<unsigned int> pad_post{fhicl::Name("pad_post"),
+                                       fhicl::Comment("Number of ticks to pad after each ROI"),
+                                       0};
+    fhicl::Atom<unsigned int> merge_gap{
+      fhicl::Name("merge_gap"),
+      fhicl::Comment("Merge ROIs separated by fewer than this many ticks"),
+      0};
   };
 
   class EventButcher : public art::EDProducer {
@@ -57,6 +83,7 @@ namespace butcher {
 
   private:
     const EventButcherConfig m_cfg;
+    wcls::sparsify::Policy m_sparsify;
     // inputs
     art::InputTag m_rawtag, m_sigtag;
     // this needs art 2.08
@@ -73,6 +100,13 @@ butcher::EventButcher::EventButcher(Parameters const& params)
 //    , m_rawtok{consumes< std::vector<raw::RawDigit> >(m_rawtag)}
 //    , m_sigtok{consumes< std::vector<recob::Wire> >(m_sigtag)}
 {
+  m_sparsify.threshold = m_cfg.threshold();
+  m_sparsify.rel_threshold = m_cfg.rel_threshold();
+  m_sparsify.min_length = m_cfg.min_length();
+  m_sparsify.pad_pre = m_cfg.pad_pre();
+  m_sparsify.pad_post = m_cfg.pad_post();
+  m_sparsify.merge_gap = m_cfg.merge_gap();
+
   //cerr << "Producing: outraw:"<<m_cfg.outRawTag()<<" outsig:"<<m_cfg.outSigTag()<<" outras:" << m_cfg.outAssnTag() << endl;
   produces<std::vector<raw::RawDigit>>(m_cfg.outRawTag());
   produces<std::vector<recob::Wire>>(m_cfg.outSigTag());
@@ -151,21 +185,14 @@ void butcher::EventButcher::produce(art::Event& event)
 
     // resparsify
     recob::Wire::RegionsOfInterest_t roi(outlen);
-    auto first = wave.begin() + ndrop;
-    auto done = wave.begin() + ndrop + outlen;
-    auto beg = first;
-    while (true) {
-      beg = std::find_if(beg, done, [](float v) { return v != 0.0; });
-      if (beg == done) { break; }
-      auto end = std::find_if(beg, done, [](float v) { return v == 0.0; });
-
-      std::vector<float> scaled(beg, end);
-      for (int ind = 0; ind < end - beg; ++ind) {
-        scaled[ind] *= sigscale;
-      }
-      roi.add_range(beg - first, scaled.begin(), scaled.end());
-      beg = end;
-    }
+    const float* first = wave.data() + ndrop;
+    const float* done = first + outlen;
+    wcls::sparsify::for_each_roi(
+      first, done, m_sparsify, sigscale, [&](const float* beg, const float* end) {
+        roi.add_range(beg - first,
+                      wcls::sparsify::ScaledIterator(beg, sigscale),
+                      wcls::sparsify::ScaledIterator(end, sigscale));
+      });
 
     const size_t outind = outsig->size();
     outsig->emplace_back(recob::Wire(roi, chid, view));
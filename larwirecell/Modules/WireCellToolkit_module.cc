@@ -1,5 +1,7 @@
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Core/SharedProducer.h"
+#include "art/Framework/Principal/Run.h"
+#include "art/Framework/Principal/SubRun.h"
 #include "art/Utilities/make_tool.h"
 #include "larwirecell/Interfaces/MainTool.h"
 
@@ -13,6 +15,10 @@ namespace wcls {
     virtual ~WireCellToolkit();
 
     void produce(art::Event& evt, art::ProcessingFrame const&);
+    void endJob(art::ProcessingFrame const&);
+    void beginRun(art::Run& run, art::ProcessingFrame const&);
+    void endRun(art::Run& run, art::ProcessingFrame const&);
+    void beginSubRun(art::SubRun& subrun, art::ProcessingFrame const&);
     void reconfigure(fhicl::ParameterSet const& pset);
 
   private:
@@ -23,9 +29,15 @@ namespace wcls {
 wcls::WireCellToolkit::WireCellToolkit(fhicl::ParameterSet const& pset, art::ProcessingFrame const&)
   : SharedProducer(pset)
 {
-  const std::string s{"WCT"};
-  serializeExternal(s);
   this->reconfigure(pset);
+  if (m_wcls->concurrency() > 1) {
+    // The tool guards its own pool of WCT instances.
+    async<art::InEvent>();
+  }
+  else {
+    const std::string s{"WCT"};
+    serializeExternal(s);
+  }
 }
 wcls::WireCellToolkit::~WireCellToolkit() {}
 
@@ -34,6 +46,26 @@ void wcls::WireCellToolkit::produce(art::Event& evt, art::ProcessingFrame const&
   m_wcls->process(evt);
 }
 
+void wcls::WireCellToolkit::endJob(art::ProcessingFrame const&)
+{
+  m_wcls->endJob();
+}
+
+void wcls::WireCellToolkit::beginRun(art::Run& run, art::ProcessingFrame const&)
+{
+  m_wcls->beginRun(run);
+}
+
+void wcls::WireCellToolkit::endRun(art::Run& run, art::ProcessingFrame const&)
+{
+  m_wcls->endRun(run);
+}
+
+void wcls::WireCellToolkit::beginSubRun(art::SubRun& subrun, art::ProcessingFrame const&)
+{
+  m_wcls->beginSubRun(subrun);
+}
+
 void wcls::WireCellToolkit::reconfigure(fhicl::ParameterSet const& pset)
 {
   auto const& wclsPS = pset.get<fhicl::ParameterSet>("wcls_main");
@@ -42,6 +74,7 @@ void wcls::WireCellToolkit::reconfigure(fhicl::ParameterSet const& pset)
     throw cet::exception("WireCellToolkit_module") << "Failed to get Art Tool \"wcls_main\"\n";
   }
   m_wcls->produces(producesCollector());
+  m_wcls->consumes(consumesCollector());
 }
 
 namespace wcls {
@@ -1,3 +1,6 @@
+#include "art/Framework/Core/ConsumesCollector.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Utilities/Globals.h"
 #include "art/Utilities/ToolConfigTable.h"
 #include "art/Utilities/ToolMacros.h"
 
@@ -5,19 +8,46 @@
 #include "larwirecell/Interfaces/MainTool.h"
 
 #include "fhiclcpp/ParameterSet.h"
+#include "fhiclcpp/types/Atom.h"
 #include "fhiclcpp/types/Comment.h"
+#include "fhiclcpp/types/OptionalAtom.h"
 #include "fhiclcpp/types/OptionalDelegatedParameter.h"
 #include "fhiclcpp/types/OptionalSequence.h"
 #include "fhiclcpp/types/Sequence.h"
 #include "fhiclcpp/types/Table.h"
 
 #include "WireCellApps/Main.h"
+#include "WireCellIface/IApplication.h"
+#include "WireCellIface/IConfigurable.h"
+#include "WireCellUtil/Configuration.h"
 #include "WireCellUtil/Logging.h"
+#include "WireCellUtil/Persist.h"
+#include "WireCellUtil/PluginManager.h"
 #include "WireCellUtil/String.h"
 
 #include "WireCellUtil/NamedFactory.h"
 
+#include "tbb/parallel_for.h"
+#include "tbb/task.h"
+#include "tbb/task_arena.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
 
 namespace wcls {
 
@@ -59,6 +89,21 @@ namespace wcls {
       fhicl::Name("structs"),
       fhicl::Comment(
         "Optional table giving external Jsonnet code to inject into WCT configuration.")};
+    fhicl::OptionalAtom<std::string> config_cache{
+      fhicl::Name("config_cache"),
+      fhicl::Comment("Optional directory caching the fully evaluated JSON of each\n"
+                     "of the 'configs'.  Entries are keyed by a hash of the contents\n"
+                     "of the config file and of every file it imports, the load\n"
+                     "paths, 'params' and 'structs'.  Several processes may share\n"
+                     "one directory.")};
+    optional_string_list_t parallel_init_types{
+      fhicl::Name("parallel_init_types"),
+      fhicl::Comment("Optional list of WCT component types which may be configured\n"
+                     "concurrently.  If given, or if 'instances' is more than one,\n"
+                     "WCLS initializes WCT itself instead of Main.  Consecutive components of these types are configured\n"
+                     "together, all others one at a time in order.  Only list types\n"
+                     "whose configure() is thread safe and neither looks up nor\n"
+                     "relies on the configuration of other components.")};
 
     // These are items needed by the tool
     optional_string_list_t inputers{
@@ -79,6 +124,117 @@ namespace wcls {
       fhicl::Name("loglevels"),
       fhicl::Comment("List of minimum WCT logger levels.\n"
                      "Specify as '<logger>:<level>' or as just '<level>' for default.")};
+
+    fhicl::Atom<int> instances{
+      fhicl::Name("instances"),
+      fhicl::Comment("Number of independently configured WCT instances.\n"
+                     "Each art event is processed by one idle instance so that\n"
+                     "up to this many events may run through WCT concurrently.\n"
+                     "Zero means one instance per art schedule.  More than one\n"
+                     "but fewer than the art schedules is an error.\n"
+                     "The WCT configuration is given the external variable\n"
+                     "'wcls_instance' and any '{instance}' in the 'apps', 'inputers'\n"
+                     "and 'outputers' names is replaced by the instance number.\n"
+                     "Components must be named uniquely per instance unless\n"
+                     "listed in 'shared'."),
+      1};
+    optional_string_list_t shared{
+      fhicl::Name("shared"),
+      fhicl::Comment("List of WCT component types or 'type:name' which several\n"
+                     "instances may share.  The WCT factory holds one component\n"
+                     "per 'type:name' so any other component configured by more\n"
+                     "than one instance is an error.  Shared components are\n"
+                     "configured only by the first instance.  Inputers and\n"
+                     "outputers change state on each event and may not be shared.")};
+
+    fhicl::Atom<int> wct_concurrency{
+      fhicl::Name("wct_concurrency"),
+      fhicl::Comment("Maximum number of instances which may execute WCT apps at once.\n"
+                     "Zero means no limit beyond 'instances'.  A smaller value\n"
+                     "pipelines events: while one event is inside WCT, other\n"
+                     "instances run their inputers on the next events and their\n"
+                     "outputers on the prior ones.  Eg, 'instances: 3' with\n"
+                     "'wct_concurrency: 1' gives a three stage pipeline.  An event\n"
+                     "waiting to enter WCT suspends its task so its art thread\n"
+                     "runs other work meanwhile."),
+      0};
+
+    fhicl::Atom<int> wct_threads{
+      fhicl::Name("wct_threads"),
+      fhicl::Comment("Maximum number of threads the WCT apps of one instance may use.\n"
+                     "WCT runs as tasks in art's TBB thread pool either way.\n"
+                     "Zero runs the apps directly in art's task arena, otherwise\n"
+                     "they run in a nested arena capped to this many threads.\n"
+                     "The cap, or art's thread count if zero, is given to the\n"
+                     "WCT configuration as the external variable 'wcls_nthreads'\n"
+                     "so that a TbbFlow engine may be sized to match."),
+      0};
+
+    fhicl::Atom<bool> stage_timing{
+      fhicl::Name("stage_timing"),
+      fhicl::Comment("If true, measure wall time, CPU time and RSS change of each\n"
+                     "inputer visit, the WCT apps and each outputer visit and print\n"
+                     "a summary table at the end of the job.  CPU time and RSS are\n"
+                     "process-wide so approximate when events run concurrently."),
+      false};
+    fhicl::OptionalAtom<std::string> stage_timing_label{
+      fhicl::Name("stage_timing_label"),
+      fhicl::Comment("If given, also save per-event stage measurements.\n"
+                     "A vector<string> named '<label>stages' holds the stage names\n"
+                     "and a vector<double> named '<label>measures' holds a flattened\n"
+                     "3xN array of (wall [s], cpu [s], rss [MB]) per stage.\n"
+                     "Implies stage_timing.")};
+  };
+
+  // The cost of running one stage of process() on one event.
+  struct StageSample {
+    double wall{0}, cpu{0}, rss{0};
+  };
+
+  // Measure one stage from construction to sample().  A disabled
+  // stopwatch costs nothing.
+  class StageStopwatch {
+  public:
+    explicit StageStopwatch(bool enabled)
+    {
+      if (!enabled) { return; }
+      m_wall = std::chrono::steady_clock::now();
+      m_cpu = cpu_now();
+      m_rss = rss_now();
+    }
+
+    StageSample sample() const
+    {
+      const std::chrono::duration<double> wall = std::chrono::steady_clock::now() - m_wall;
+      return {wall.count(), cpu_now() - m_cpu, rss_now() - m_rss};
+    }
+
+  private:
+    std::chrono::steady_clock::time_point m_wall;
+    double m_cpu{0}, m_rss{0};
+
+    // User plus system CPU time [s] of the whole process.  A stage may
+    // use many threads so this, like RSS, is process-wide and only
+    // approximate when events run concurrently.
+    static double cpu_now()
+    {
+      rusage ru;
+      if (getrusage(RUSAGE_SELF, &ru) != 0) { return 0; }
+      return ru.ru_utime.tv_sec + 1e-6 * ru.ru_utime.tv_usec + ru.ru_stime.tv_sec +
+             1e-6 * ru.ru_stime.tv_usec;
+    }
+
+    // Resident set size [MB] of the whole process.
+    static double rss_now()
+    {
+      static const double page_mb = sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+      long size = 0, resident = 0;
+      FILE* fp = std::fopen("/proc/self/statm", "r");
+      if (!fp) { return 0; }
+      if (std::fscanf(fp, "%ld %ld", &size, &resident) != 2) { resident = 0; }
+      std::fclose(fp);
+      return resident * page_mb;
+    }
   };
 
   class WCLS : public MainTool {
@@ -90,43 +246,488 @@ namespace wcls {
 
     void produces(art::ProducesCollector& collector)
     {
-      for (auto iaev : m_outputers) {
+      // All instances share one configuration so promise only once.
+      for (auto iaev : m_pool.front()->outputers) {
         iaev->produces(collector);
       }
+      if (!m_timing_label.empty()) {
+        collector.produces<std::vector<std::string>>(m_timing_label + "stages");
+        collector.produces<std::vector<double>>(m_timing_label + "measures");
+      }
+    }
+    void consumes(art::ConsumesCollector& collector)
+    {
+      for (auto iaev : visitors()) {
+        iaev->consumes(collector);
+      }
     }
     void process(art::Event& event);
 
+    std::size_t concurrency() const { return m_pool.size(); }
+
+    void endJob();
+
+    void beginRun(art::Run const& run)
+    {
+      for (auto iaev : visitors()) {
+        iaev->beginRun(run);
+      }
+    }
+    void endRun(art::Run const& run)
+    {
+      for (auto iaev : visitors()) {
+        iaev->endRun(run);
+      }
+    }
+    void beginSubRun(art::SubRun const& subrun)
+    {
+      for (auto iaev : visitors()) {
+        iaev->beginSubRun(subrun);
+      }
+    }
+
   private:
-    WireCell::Main m_wcmain;
-    wcls::IArtEventVisitor::vector m_inputers, m_outputers;
-    // for c2: m_prod is not used
-    // art::EDProducer* m_prod;
+    // One independently configured WCT and the art event visitors
+    // which feed and drain it.
+    struct Instance {
+      WireCell::Main wcmain;
+      wcls::IArtEventVisitor::vector inputers, outputers;
+      // The "type:name" of each configured component.
+      std::vector<std::string> components;
+      // Caps WCT threads if wct_threads is set.
+      std::unique_ptr<tbb::task_arena> arena;
+    };
+    std::vector<std::unique_ptr<Instance>> m_pool;
+
+    // Indices into m_pool of the instances not currently processing
+    // an event.
+    std::vector<std::size_t> m_idle;
+    std::mutex m_mutex;
+
+    // Admission to the WCT stage of process() when wct_concurrency
+    // bounds it.  An event finding no free slot suspends its task,
+    // which frees its art worker thread to run other tasks, and is
+    // resumed by the next event leaving WCT.
+    std::size_t m_wct_width{0}, m_wct_free{0};
+    std::deque<tbb::task::suspend_point> m_wct_waiting;
+    std::mutex m_wct_mutex;
+
+    void enter_wct();
+    void leave_wct();
+
+    // Stage instrumentation.  Samples are indexed by stage in the
+    // order: inputers, WCT, outputers.
+    bool m_timing{false};
+    std::string m_timing_label;
+    std::vector<std::string> m_stage_names;
+    std::vector<std::vector<StageSample>> m_stage_samples;
+    std::mutex m_timing_mutex;
+
+    void record(art::Event& event, const std::vector<StageSample>& samples);
+
+    void configure(Instance& inst, const WCLSConfig& wclscfg, std::size_t ind, bool pooled);
+    void check_shared(const WCLSConfig& wclscfg) const;
+
+    std::size_t acquire();
+    void release(std::size_t ind);
+
+    // All inputers and outputers of all instances, each once.
+    wcls::IArtEventVisitor::vector visitors() const;
   };
 }
 
-wcls::WCLS::WCLS(wcls::WCLS::Parameters const& params) : m_wcmain()
+// Replace every "{instance}" in name with the instance number.
+static std::string instance_name(std::string name, std::size_t ind)
+{
+  const std::string key = "{instance}";
+  const std::string num = std::to_string(ind);
+  for (auto pos = name.find(key); pos != std::string::npos; pos = name.find(key, pos)) {
+    name.replace(pos, key.size(), num);
+    pos += num.size();
+  }
+  return name;
+}
+
+// 64 bit FNV-1a hash to key cached configuration.
+class ConfigHash {
+public:
+  void operator()(const std::string& str)
+  {
+    for (unsigned char c : str) {
+      m_hash = (m_hash ^ c) * 0x100000001b3ULL;
+    }
+    // Separate consecutive strings so that ("ab","c") != ("a","bc").
+    m_hash = (m_hash ^ 0xff) * 0x100000001b3ULL;
+  }
+  std::string hex() const
+  {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(m_hash));
+    return buf;
+  }
+
+private:
+  unsigned long long m_hash{0xcbf29ce484222325ULL};
+};
+
+// Hash the path and contents of a Jsonnet file and, recursively, of
+// each file it imports.  Jsonnet requires import paths to be string
+// literals so they may be found by pattern.  As Jsonnet does, an
+// import is looked for relative to the importing file and then on the
+// load path.  Matches in comments only add to the key.
+static void hash_imports(const std::string& path,
+                         WireCell::Persist::Parser& parser,
+                         ConfigHash& hash,
+                         std::set<std::string>& seen)
+{
+  namespace fs = std::filesystem;
+  if (!seen.insert(path).second) { return; }
+  const std::string text = WireCell::Persist::slurp(path);
+  hash(path);
+  hash(text);
+
+  static const std::regex re(R"re(\bimport(?:str|bin)?\s*@?(["'])(.*?)\1)re");
+  const std::string dir = fs::path(path).parent_path().string();
+  for (std::sregex_iterator it(text.begin(), text.end(), re), end; it != end; ++it) {
+    const std::string name = (*it)[2].str();
+    std::string found;
+    const fs::path local = fs::path(dir) / name;
+    if (fs::exists(local)) { found = local.string(); }
+    else {
+      found = parser.resolve(name);
+    }
+    if (found.empty()) {
+      hash(name);
+      continue;
+    }
+    hash_imports(found, parser, hash, seen);
+  }
+}
+
+// Return the name of a JSON file in cachedir holding the evaluated
+// configuration file, evaluating and caching it on a miss.  The file
+// is written under a process-unique name and renamed into place so
+// readers sharing cachedir only ever see complete entries.  Any
+// failure falls back to the original configuration file.
+static std::string cached_config(const std::string& cachedir,
+                                 const std::string& filename,
+                                 const std::vector<std::string>& load_paths,
+                                 const WireCell::Persist::externalvars_t& extvars,
+                                 const WireCell::Persist::externalvars_t& extcode)
+{
+  namespace fs = std::filesystem;
+  try {
+    WireCell::Persist::Parser parser(load_paths, extvars, extcode);
+    const std::string path = parser.resolve(filename);
+    if (path.empty()) { return filename; }
+
+    ConfigHash hash;
+    std::set<std::string> seen;
+    hash_imports(path, parser, hash, seen);
+    for (const auto& lp : load_paths) {
+      hash(lp);
+    }
+    const char* wcpath = std::getenv("WIRECELL_PATH");
+    hash(wcpath ? wcpath : "");
+    for (const auto& kv : extvars) {
+      hash(kv.first);
+      hash(kv.second);
+    }
+    hash("structs");
+    for (const auto& kv : extcode) {
+      hash(kv.first);
+      hash(kv.second);
+    }
+
+    const std::string stem = fs::path(filename).stem().string();
+    const fs::path cached = fs::path(cachedir) / (stem + "-" + hash.hex() + ".json");
+    if (fs::exists(cached)) {
+      std::cerr << "WCLS: using cached configuration " << cached << "\n";
+      return cached.string();
+    }
+
+    Json::Value jcfg = parser.load(filename);
+
+    fs::create_directories(cachedir);
+    const fs::path tmp = fs::path(cachedir) / (stem + "-" + hash.hex() + "." +
+                                               std::to_string(getpid()) + ".tmp.json");
+    try {
+      WireCell::Persist::dump(tmp.string(), jcfg);
+      fs::rename(tmp, cached);
+    }
+    catch (...) {
+      std::error_code ec;
+      fs::remove(tmp, ec);
+      throw;
+    }
+    std::cerr << "WCLS: cached configuration " << cached << "\n";
+    return cached.string();
+  }
+  catch (const std::exception& err) {
+    std::cerr << "WCLS: not caching configuration \"" << filename << "\": " << err.what()
+              << "\n";
+  }
+  return filename;
+}
+
+// Evaluate the configuration files into a list of component
+// configurations.  The plugins and apps of any "wire-cell" entry are
+// added to those given.
+static std::vector<WireCell::Configuration>
+load_components(const std::vector<std::string>& configs,
+                const std::vector<std::string>& load_paths,
+                const WireCell::Persist::externalvars_t& extvars,
+                const WireCell::Persist::externalvars_t& extcode,
+                std::vector<std::string>& plugins,
+                std::vector<std::string>& apps)
+{
+  using namespace WireCell;
+
+  std::vector<Configuration> comps;
+  for (const auto& filename : configs) {
+    Persist::Parser parser(load_paths, extvars, extcode);
+    Configuration jcfg = parser.load(filename);
+    if (jcfg.isObject()) {
+      Configuration one = jcfg;
+      jcfg = Json::arrayValue;
+      jcfg.append(one);
+    }
+    for (const auto& jcomp : jcfg) {
+      if (jcomp.isNull()) { continue; }
+      if (jcomp["type"].asString() == "wire-cell") {
+        for (const auto& jplugin : jcomp["data"]["plugins"]) {
+          plugins.push_back(jplugin.asString());
+        }
+        for (const auto& japp : jcomp["data"]["apps"]) {
+          apps.push_back(japp.asString());
+        }
+        continue;
+      }
+      comps.push_back(jcomp);
+    }
+  }
+  return comps;
+}
+
+// Return the "type:name" of a component configuration, or just the
+// type if unnamed.
+static std::string component_tn(const WireCell::Configuration& jcomp)
+{
+  const std::string type = jcomp["type"].asString();
+  const std::string name = jcomp["name"].asString();
+  return name.empty() ? type : type + ":" + name;
+}
+
+// True if tn, or its type, is listed in shared.
+static bool is_shared(const std::vector<std::string>& shared, const std::string& tn)
+{
+  const std::string type = tn.substr(0, tn.find(':'));
+  return std::find(shared.begin(), shared.end(), tn) != shared.end() ||
+         std::find(shared.begin(), shared.end(), type) != shared.end();
+}
+
+// Initialize WCT from evaluated component configurations as
+// Main::initialize() does.  Components in skip already exist and are
+// configured so are left as they are.  Runs of consecutive components
+// of the safe types are configured concurrently.  A run ends at a
+// component of another type, which is configured alone, or at one
+// named again.  So each component sees its default configuration
+// after all components before it in order are configured, as when
+// serial.
+static void initialize_components(const std::vector<WireCell::Configuration>& comps,
+                                  const std::vector<std::string>& plugins,
+                                  const std::vector<std::string>& apps,
+                                  const std::set<std::string>& safe_types,
+                                  const std::set<std::string>& skip)
+{
+  using namespace WireCell;
+
+  auto& pm = PluginManager::instance();
+  for (const auto& plugin : plugins) {
+    pm.add(plugin);
+  }
+  for (const auto& app : apps) {
+    Factory::lookup_tn<IApplication>(app);
+  }
+
+  // Construct all first, serially, as Main does.
+  const size_t ncomps = comps.size();
+  std::vector<std::string> types(ncomps), tns(ncomps);
+  std::vector<IConfigurable::pointer> cfgobjs(ncomps);
+  size_t nskipped = 0;
+  for (size_t ind = 0; ind < ncomps; ++ind) {
+    const std::string name = get<std::string>(comps[ind], "name", "");
+    types[ind] = get<std::string>(comps[ind], "type");
+    tns[ind] = component_tn(comps[ind]);
+    Factory::lookup<Interface>(types[ind], name);
+    if (skip.count(tns[ind])) {
+      ++nskipped;
+      continue;
+    }
+    cfgobjs[ind] = Factory::find_maybe<IConfigurable>(types[ind], name);
+  }
+
+  size_t nruns = 0;
+  for (size_t ind = 0; ind < ncomps;) {
+    std::vector<size_t> run;
+    std::set<std::string> named;
+    while (ind < ncomps && safe_types.count(types[ind]) && named.insert(tns[ind]).second) {
+      run.push_back(ind++);
+    }
+    if (run.empty()) { run.push_back(ind++); }
+
+    // Defaults are taken serially, after all earlier configure().
+    std::vector<Configuration> cfgs(run.size());
+    for (size_t irun = 0; irun < run.size(); ++irun) {
+      const auto& cfgobj = cfgobjs[run[irun]];
+      if (!cfgobj) { continue; }
+      Configuration cfg = cfgobj->default_configuration();
+      Configuration data = comps[run[irun]]["data"];
+      cfgs[irun] = update(cfg, data);
+    }
+    auto configure = [&](size_t irun) {
+      if (cfgobjs[run[irun]]) { cfgobjs[run[irun]]->configure(cfgs[irun]); }
+    };
+    if (run.size() > 1) {
+      tbb::parallel_for(size_t(0), run.size(), configure);
+      ++nruns;
+    }
+    else {
+      configure(0);
+    }
+  }
+  std::cerr << "WCLS: configured " << ncomps - nskipped << " components";
+  if (!safe_types.empty()) { std::cerr << " with " << nruns << " concurrent runs"; }
+  if (nskipped) { std::cerr << ", " << nskipped << " shared already configured"; }
+  std::cerr << "\n";
+}
+
+wcls::WCLS::WCLS(wcls::WCLS::Parameters const& params)
 {
   const auto& wclscfg = params();
+
+  // An event never waits for an instance as that would park one of
+  // art's TBB worker threads.  A single instance is serialized by the
+  // module, more must cover every art schedule.
+  const std::size_t nschedules = art::Globals::instance()->nschedules();
+  std::size_t ninstances = std::max(wclscfg.instances(), 0);
+  if (ninstances == 0) { ninstances = nschedules; }
+  ninstances = std::max<std::size_t>(ninstances, 1);
+  if (ninstances > 1 && ninstances < nschedules) {
+    throw cet::exception("WCLS") << "WCLS: " << ninstances << " WCT instances for " << nschedules
+                                 << " art schedules, need one or at least one per schedule\n";
+  }
+
+  for (std::size_t ind = 0; ind < ninstances; ++ind) {
+    m_pool.push_back(std::make_unique<Instance>());
+    configure(*m_pool.back(), wclscfg, ind, ninstances > 1);
+    m_idle.push_back(ind);
+  }
+  if (ninstances > 1) {
+    std::cerr << "WCLS: running " << ninstances << " WCT instances\n";
+    check_shared(wclscfg);
+  }
+
+  m_wct_width = std::max(wclscfg.wct_concurrency(), 0);
+  if (m_wct_width >= ninstances) { m_wct_width = 0; }
+  m_wct_free = m_wct_width;
+  if (m_wct_width) {
+    std::cerr << "WCLS: pipelining with at most " << m_wct_width << " instances in WCT\n";
+  }
+
+  m_timing = wclscfg.stage_timing();
+  if (wclscfg.stage_timing_label(m_timing_label)) { m_timing = true; }
+  if (m_timing) {
+    WCLSConfig::optional_string_list_t::value_type slist;
+    if (wclscfg.inputers(slist)) {
+      for (const auto& name : slist) {
+        m_stage_names.push_back("in:" + name);
+      }
+    }
+    slist.clear();
+    m_stage_names.push_back("wct");
+    if (wclscfg.outputers(slist)) {
+      for (const auto& name : slist) {
+        m_stage_names.push_back("out:" + name);
+      }
+    }
+    m_stage_samples.resize(m_stage_names.size());
+  }
+}
+
+// Throw if a component is configured by more than one instance and
+// is not listed as shared or if an inputer or outputer is listed as
+// shared.  Visitors change state on each event which other instances
+// would see unsynchronized.
+void wcls::WCLS::check_shared(const WCLSConfig& wclscfg) const
+{
+  WCLSConfig::optional_string_list_t::value_type shared;
+  wclscfg.shared(shared);
+
+  for (const auto* visitors : {&wclscfg.inputers, &wclscfg.outputers}) {
+    WCLSConfig::optional_string_list_t::value_type names;
+    if (!(*visitors)(names)) { continue; }
+    for (const auto& name : names) {
+      for (std::size_t ind = 0; ind < m_pool.size(); ++ind) {
+        const std::string tn = instance_name(name, ind);
+        if (!is_shared(shared, tn)) { continue; }
+        throw cet::exception("WCLS") << "WCLS: inputer or outputer \"" << tn
+                                     << "\" may not be listed in 'shared'\n";
+      }
+    }
+  }
+
+  std::unordered_map<std::string, std::size_t> ninst;
+  for (const auto& inst : m_pool) {
+    auto comps = inst->components;
+    std::sort(comps.begin(), comps.end());
+    comps.erase(std::unique(comps.begin(), comps.end()), comps.end());
+    for (const auto& tn : comps) {
+      ++ninst[tn];
+    }
+  }
+  std::vector<std::string> bad;
+  for (const auto& [tn, count] : ninst) {
+    if (count > 1 && !is_shared(shared, tn)) { bad.push_back(tn); }
+  }
+  if (bad.empty()) { return; }
+  std::sort(bad.begin(), bad.end());
+  cet::exception err("WCLS");
+  err << "WCLS: components configured by several WCT instances but not listed in 'shared':";
+  for (const auto& tn : bad) {
+    err << " " << tn;
+  }
+  err << "\nName them with 'wcls_instance' or list them in 'shared'.\n";
+  throw err;
+}
+
+void wcls::WCLS::configure(Instance& inst,
+                           const WCLSConfig& wclscfg,
+                           std::size_t ind,
+                           bool pooled)
+{
+  auto& wcmain = inst.wcmain;
   WCLSConfig::optional_string_list_t::value_type slist;
 
-  if (wclscfg.logsinks(slist)) {
+  // Logging is process global so set it up just once.
+  if (ind == 0 && wclscfg.logsinks(slist)) {
     for (auto logsink : slist) {
       //std::cerr << "Log sink: \"" << logsink << "\"\n";
       auto ls = WireCell::String::split(logsink, ":");
-      if (ls.size() == 2) { m_wcmain.add_logsink(ls[0], ls[1]); }
+      if (ls.size() == 2) { wcmain.add_logsink(ls[0], ls[1]); }
       else {
-        m_wcmain.add_logsink(ls[0]);
+        wcmain.add_logsink(ls[0]);
       }
     }
   }
   slist.clear();
-  if (wclscfg.loglevels(slist)) {
+  if (ind == 0 && wclscfg.loglevels(slist)) {
     for (auto loglevel : slist) {
       //std::cerr << "Log level: \"" << loglevel << "\"\n";
       auto ll = WireCell::String::split(loglevel, ":");
-      if (ll.size() == 2) { m_wcmain.set_loglevel(ll[0], ll[1]); }
+      if (ll.size() == 2) { wcmain.set_loglevel(ll[0], ll[1]); }
       else {
-        m_wcmain.set_loglevel("", ll[0]);
+        wcmain.set_loglevel("", ll[0]);
       }
     }
   }
@@ -135,35 +736,29 @@ wcls::WCLS::WCLS(wcls::WCLS::Parameters const& params) : m_wcmain()
 
   // transfer configuration
 
-  // required
-
-  for (auto cfg : wclscfg.configs()) {
-    m_wcmain.add_config(cfg);
-  }
-
-  for (auto app : wclscfg.apps()) {
-    m_wcmain.add_app(app);
-  }
-
-  for (auto plugin : wclscfg.plugins()) {
-    m_wcmain.add_plugin(plugin);
-  }
-
   // optional
 
+  std::vector<std::string> load_paths;
   if (wclscfg.paths(slist)) {
     for (auto path : slist) {
-      m_wcmain.add_path(path);
+      wcmain.add_path(path);
+      load_paths.push_back(path);
     }
   }
   slist.clear();
 
+  WireCell::Persist::externalvars_t extvars, extcode;
   {
     fhicl::ParameterSet wcps;
     if (wclscfg.params.get_if_present(wcps)) {
       for (auto key : wcps.get_names()) {
+        if (key == "wcls_instance" || key == "wcls_nthreads") {
+          throw cet::exception("WCLS")
+            << "WCLS: 'params' may not set \"" << key << "\" which WCLS provides\n";
+        }
         auto value = wcps.get<std::string>(key);
-        m_wcmain.add_var(key, value);
+        wcmain.add_var(key, value);
+        extvars[key] = value;
       }
     }
   }
@@ -172,14 +767,76 @@ wcls::WCLS::WCLS(wcls::WCLS::Parameters const& params) : m_wcmain()
     if (wclscfg.structs.get_if_present(wcps)) {
       for (auto key : wcps.get_names()) {
         auto value = wcps.get<std::string>(key);
-        m_wcmain.add_code(key, value);
+        wcmain.add_code(key, value);
+        extcode[key] = value;
       }
     }
   }
+  wcmain.add_var("wcls_instance", std::to_string(ind));
+  extvars["wcls_instance"] = std::to_string(ind);
+
+  // Share art's thread pool rather than have WCT start its own.
+  const int wct_threads = std::max(wclscfg.wct_threads(), 0);
+  if (wct_threads) { inst.arena = std::make_unique<tbb::task_arena>(wct_threads); }
+  const std::string nthreads =
+    std::to_string(wct_threads ? wct_threads : art::Globals::instance()->nthreads());
+  wcmain.add_var("wcls_nthreads", nthreads);
+  extvars["wcls_nthreads"] = nthreads;
+
+  // required
+
+  std::string cachedir;
+  wclscfg.config_cache(cachedir);
+  std::vector<std::string> configs;
+  for (auto cfg : wclscfg.configs()) {
+    if (!cachedir.empty()) { cfg = cached_config(cachedir, cfg, load_paths, extvars, extcode); }
+    wcmain.add_config(cfg);
+    configs.push_back(cfg);
+  }
+
+  std::vector<std::string> apps;
+  for (auto app : wclscfg.apps()) {
+    apps.push_back(instance_name(app, ind));
+    wcmain.add_app(apps.back());
+  }
+
+  std::vector<std::string> plugins;
+  for (auto plugin : wclscfg.plugins()) {
+    wcmain.add_plugin(plugin);
+    plugins.push_back(plugin);
+  }
 
   //std::cerr << "Initialize Wire Cell\n";
+  const auto init_start = std::chrono::steady_clock::now();
   try {
-    m_wcmain.initialize();
+    WCLSConfig::optional_string_list_t::value_type safe_types, shared;
+    wclscfg.parallel_init_types(safe_types);
+    if (pooled || !safe_types.empty()) {
+      // Evaluate once for both noting what this instance configures,
+      // so sharing can be checked, and initializing.  Shared
+      // components are configured only by the first instance.
+      auto comps = load_components(configs, load_paths, extvars, extcode, plugins, apps);
+      for (size_t iapp = wclscfg.apps().size(); iapp < apps.size(); ++iapp) {
+        wcmain.add_app(apps[iapp]);
+      }
+      wclscfg.shared(shared);
+      std::set<std::string> skip;
+      for (const auto& jcomp : comps) {
+        const std::string tn = component_tn(jcomp);
+        inst.components.push_back(tn);
+        if (ind == 0 || !is_shared(shared, tn)) { continue; }
+        const auto& first = m_pool.front()->components;
+        if (std::find(first.begin(), first.end(), tn) != first.end()) { skip.insert(tn); }
+      }
+      initialize_components(comps,
+                            plugins,
+                            apps,
+                            std::set<std::string>(safe_types.begin(), safe_types.end()),
+                            skip);
+    }
+    else {
+      wcmain.initialize();
+    }
   }
   catch (WireCell::Exception& e) {
     std::cerr << "Wire Cell Toolkit threw an exception\n";
@@ -187,39 +844,224 @@ wcls::WCLS::WCLS(wcls::WCLS::Parameters const& params) : m_wcmain()
     std::cerr << msg << std::endl;
     throw cet::exception("WireCellLArSoft") << msg;
   }
+  const std::chrono::duration<double> init_time = std::chrono::steady_clock::now() - init_start;
+  std::cerr << "WCLS: initialized WCT instance " << ind << " in " << init_time.count() << " s\n";
 
   if (wclscfg.inputers(slist)) {
     for (auto inputer : slist) {
+      inputer = instance_name(inputer, ind);
       auto iaev = WireCell::Factory::find_tn<IArtEventVisitor>(inputer);
-      m_inputers.push_back(iaev);
+      inst.inputers.push_back(iaev);
       std::cerr << "Inputer: \"" << inputer << "\"\n";
     }
   }
   slist.clear();
   if (wclscfg.outputers(slist)) {
     for (auto outputer : slist) {
+      outputer = instance_name(outputer, ind);
       auto iaev = WireCell::Factory::find_tn<IArtEventVisitor>(outputer);
-      m_outputers.push_back(iaev);
+      inst.outputers.push_back(iaev);
       std::cerr << "Outputer: \"" << outputer << "\"\n";
     }
   }
   slist.clear();
 }
 
+wcls::IArtEventVisitor::vector wcls::WCLS::visitors() const
+{
+  wcls::IArtEventVisitor::vector ret;
+  for (const auto& inst : m_pool) {
+    for (const auto* iaevs : {&inst->inputers, &inst->outputers}) {
+      for (auto iaev : *iaevs) {
+        if (std::find(ret.begin(), ret.end(), iaev) == ret.end()) { ret.push_back(iaev); }
+      }
+    }
+  }
+  return ret;
+}
+
+std::size_t wcls::WCLS::acquire()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  // There is an instance per art schedule so one is always idle.
+  if (m_idle.empty()) { throw cet::exception("WCLS") << "WCLS: no idle WCT instance\n"; }
+  const std::size_t ind = m_idle.back();
+  m_idle.pop_back();
+  return ind;
+}
+
+void wcls::WCLS::release(std::size_t ind)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_idle.push_back(ind);
+}
+
+void wcls::WCLS::enter_wct()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_wct_mutex);
+    if (m_wct_free) {
+      --m_wct_free;
+      return;
+    }
+  }
+  // The slot is handed over by leave_wct() which resumes us.  Check
+  // again under the lock as one may have been freed meanwhile.
+  tbb::task::suspend([this](tbb::task::suspend_point tag) {
+    std::lock_guard<std::mutex> lock(m_wct_mutex);
+    if (m_wct_free) {
+      --m_wct_free;
+      tbb::task::resume(tag);
+      return;
+    }
+    m_wct_waiting.push_back(tag);
+  });
+}
+
+void wcls::WCLS::leave_wct()
+{
+  std::lock_guard<std::mutex> lock(m_wct_mutex);
+  if (m_wct_waiting.empty()) {
+    ++m_wct_free;
+    return;
+  }
+  tbb::task::resume(m_wct_waiting.front());
+  m_wct_waiting.pop_front();
+}
+
 void wcls::WCLS::process(art::Event& event)
 {
-  for (auto iaev : m_inputers) {
+  // Borrow an idle instance for the duration of this event.
+  struct Lease {
+    WCLS& wcls;
+    const std::size_t ind;
+    ~Lease() { wcls.release(ind); }
+  } lease{*this, acquire()};
+  auto& inst = *m_pool[lease.ind];
+
+  std::vector<StageSample> samples;
+  if (m_timing) { samples.reserve(m_stage_names.size()); }
+
+  for (auto iaev : inst.inputers) {
     //std::cerr << "pre visit\n";
+    StageStopwatch sw(m_timing);
     iaev->visit(event);
+    if (m_timing) { samples.push_back(sw.sample()); }
   }
 
-  //std::cerr << "Running Wire Cell Toolkit...\n";
-  m_wcmain();
-  //std::cerr << "... Wire Cell Toolkit done\n";
+  {
+    //std::cerr << "Running Wire Cell Toolkit...\n";
+    StageStopwatch sw(m_timing);
+    struct Slot {
+      WCLS& wcls;
+      Slot(WCLS& wcls) : wcls(wcls)
+      {
+        if (wcls.m_wct_width) { wcls.enter_wct(); }
+      }
+      ~Slot()
+      {
+        if (wcls.m_wct_width) { wcls.leave_wct(); }
+      }
+    } slot{*this};
+    if (inst.arena) {
+      inst.arena->execute([&inst] { inst.wcmain(); });
+    }
+    else {
+      inst.wcmain();
+    }
+    if (m_timing) { samples.push_back(sw.sample()); }
+    //std::cerr << "... Wire Cell Toolkit done\n";
+  }
 
-  for (auto iaev : m_outputers) {
+  for (auto iaev : inst.outputers) {
     //std::cerr << "post visit\n";
+    StageStopwatch sw(m_timing);
     iaev->visit(event);
+    if (m_timing) { samples.push_back(sw.sample()); }
+  }
+
+  if (m_timing) { record(event, samples); }
+}
+
+void wcls::WCLS::record(art::Event& event, const std::vector<StageSample>& samples)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_timing_mutex);
+    for (std::size_t ind = 0; ind < samples.size(); ++ind) {
+      m_stage_samples[ind].push_back(samples[ind]);
+    }
+  }
+
+  if (m_timing_label.empty()) { return; }
+  auto names = std::make_unique<std::vector<std::string>>(m_stage_names);
+  auto measures = std::make_unique<std::vector<double>>();
+  measures->reserve(3 * samples.size());
+  for (const auto& sample : samples) {
+    measures->push_back(sample.wall);
+    measures->push_back(sample.cpu);
+    measures->push_back(sample.rss);
+  }
+  event.put(std::move(names), m_timing_label + "stages");
+  event.put(std::move(measures), m_timing_label + "measures");
+}
+
+// Nearest-rank percentile of sorted values.
+static double percentile(const std::vector<double>& sorted, double pct)
+{
+  if (sorted.empty()) { return 0; }
+  const double rank = std::ceil(pct / 100.0 * sorted.size()) - 1;
+  return sorted[std::clamp<double>(rank, 0, sorted.size() - 1)];
+}
+
+void wcls::WCLS::endJob()
+{
+  if (!m_timing) { return; }
+
+  std::lock_guard<std::mutex> lock(m_timing_mutex);
+  const std::size_t nevents = m_stage_samples.empty() ? 0 : m_stage_samples.front().size();
+  std::cerr << "WCLS: stage timing over " << nevents << " events\n";
+
+  char line[256];
+  std::snprintf(line,
+                sizeof(line),
+                "%-32s %-9s %10s %10s %10s %10s %10s\n",
+                "stage",
+                "measure",
+                "mean",
+                "p50",
+                "p90",
+                "p99",
+                "max");
+  std::cerr << line;
+
+  const char* measure_names[3] = {"wall[s]", "cpu[s]", "rss[MB]"};
+  for (std::size_t istage = 0; istage < m_stage_names.size(); ++istage) {
+    const auto& stage_samples = m_stage_samples[istage];
+    if (stage_samples.empty()) { continue; }
+    for (int imeas = 0; imeas < 3; ++imeas) {
+      std::vector<double> vals;
+      vals.reserve(stage_samples.size());
+      for (const auto& sample : stage_samples) {
+        vals.push_back(imeas == 0 ? sample.wall : imeas == 1 ? sample.cpu : sample.rss);
+      }
+      std::sort(vals.begin(), vals.end());
+      double mean = 0;
+      for (double val : vals) {
+        mean += val;
+      }
+      mean /= vals.size();
+      std::snprintf(line,
+                    sizeof(line),
+                    "%-32s %-9s %10.4g %10.4g %10.4g %10.4g %10.4g\n",
+                    imeas ? "" : m_stage_names[istage].c_str(),
+                    measure_names[imeas],
+                    mean,
+                    percentile(vals, 50),
+                    percentile(vals, 90),
+                    percentile(vals, 99),
+                    vals.back());
+      std::cerr << line;
+    }
   }
 }
 
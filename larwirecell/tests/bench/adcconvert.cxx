@@ -0,0 +1,108 @@
+// Check the ADC conversion kernels of AdcConvert.h against a plain
+// loop and measure the bandwidth each reaches.
+//
+//   c++ -O2 -std=c++17 -I larwirecell/Components adcconvert.cxx -o adcconvert
+//   ./adcconvert [nchannels [nticks]]
+//
+// Exits nonzero if any kernel differs from the plain loop.
+
+#include "AdcConvert.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace wcls;
+
+static void convert_reference(const short* in, size_t nin, float* out, size_t nout, float pad)
+{
+  for (size_t ind = 0; ind < nout; ++ind) {
+    out[ind] = ind < nin ? float(in[ind]) : pad;
+  }
+}
+
+struct Kernel {
+  std::string name;
+  adc::convert_t func;
+};
+
+static std::vector<Kernel> kernels()
+{
+  std::vector<Kernel> ret{{"scalar", adc::convert_scalar}};
+#ifdef WCLS_ADCCONVERT_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) { ret.push_back({"avx2", adc::convert_avx2}); }
+  if (__builtin_cpu_supports("avx512f")) { ret.push_back({"avx512", adc::convert_avx512}); }
+#endif
+  return ret;
+}
+
+// Every length up to a few vectors, truncated and padded, at every
+// alignment of the input and output.
+static int check(const Kernel& kernel, std::mt19937& rng)
+{
+  std::uniform_int_distribution<int> dist(-32768, 32767);
+  std::vector<short> in(200);
+  for (auto& adc : in) {
+    adc = dist(rng);
+  }
+  std::vector<float> want(200), got(200);
+  int nbad = 0;
+  for (size_t off = 0; off < 8; ++off) {
+    for (size_t nin = 0; nin < 100; ++nin) {
+      for (size_t nout : {nin / 2, nin, nin + 7, nin + 40}) {
+        convert_reference(in.data() + off, nin, want.data() + off, nout, -3.5f);
+        kernel.func(in.data() + off, nin, got.data() + off, nout, -3.5f);
+        if (std::memcmp(want.data() + off, got.data() + off, nout * sizeof(float))) {
+          std::printf("%s: differs at off=%zu nin=%zu nout=%zu\n",
+                      kernel.name.c_str(), off, nin, nout);
+          ++nbad;
+        }
+      }
+    }
+  }
+  return nbad;
+}
+
+int main(int argc, char* argv[])
+{
+  const size_t nchannels = argc > 1 ? std::atoi(argv[1]) : 15360;
+  const size_t nticks = argc > 2 ? std::atoi(argv[2]) : 6000;
+
+  std::mt19937 rng(1234);
+  int nbad = 0;
+  for (const auto& kernel : kernels()) {
+    nbad += check(kernel, rng);
+  }
+
+  // A readout of 12 bit ADCs around a baseline, the last 10% of the
+  // ticks padded as when nticks exceeds the digit length.
+  std::normal_distribution<float> noise(900, 5);
+  const size_t nin = nticks - nticks / 10;
+  std::vector<short> adcs(nchannels * nin);
+  for (auto& adc : adcs) {
+    adc = short(noise(rng));
+  }
+  std::vector<float> charge(nticks);
+  const double bytes = double(nchannels) * (nin * sizeof(short) + nticks * sizeof(float));
+
+  std::printf("%zu channels x %zu ticks, %.0f MB moved per pass\n", nchannels, nticks, bytes / 1e6);
+  for (const auto& kernel : kernels()) {
+    const int npasses = 5;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < npasses; ++pass) {
+      for (size_t ich = 0; ich < nchannels; ++ich) {
+        kernel.func(adcs.data() + ich * nin, nin, charge.data(), nticks, 900);
+      }
+    }
+    std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+    std::printf("%-8s %8.2f ms/pass %8.2f GB/s\n",
+                kernel.name.c_str(), 1e3 * dt.count() / npasses, npasses * bytes / dt.count() / 1e9);
+  }
+  if (nbad) { std::printf("%d mismatches\n", nbad); }
+  return nbad ? 1 : 0;
+}
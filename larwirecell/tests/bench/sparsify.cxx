@@ -0,0 +1,158 @@
+// Check the exact ROI sparsification of Sparsify.h against the
+// std::find_if loop with a scaled temporary it replaced in
+// wclsFrameSaver and measure the time of each.
+//
+//   c++ -O2 -std=c++17 -I larwirecell/Components sparsify.cxx -o sparsify
+//   ./sparsify [nchannels [nticks]]
+//
+// Exits nonzero if the ROIs or their samples differ in any bit.
+
+#include "Sparsify.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace wcls;
+
+// Stands in for the ROI storage of a recob::Wire.
+struct ROIs {
+  std::vector<size_t> offsets, sizes;
+  std::vector<float> samples;
+
+  void clear()
+  {
+    offsets.clear();
+    sizes.clear();
+    samples.clear();
+  }
+  template <typename It>
+  void add_range(size_t offset, It beg, It end)
+  {
+    offsets.push_back(offset);
+    const size_t before = samples.size();
+    samples.insert(samples.end(), beg, end);
+    sizes.push_back(samples.size() - before);
+  }
+  bool operator==(const ROIs& other) const
+  {
+    return offsets == other.offsets && sizes == other.sizes &&
+           samples.size() == other.samples.size() &&
+           !std::memcmp(samples.data(), other.samples.data(), samples.size() * sizeof(float));
+  }
+};
+
+static double reference(const float* first, const float* end, double scale, ROIs& rois)
+{
+  std::vector<float> scaled;
+  double total_charge = 0;
+  const float* beg = first;
+  while (true) {
+    beg = std::find_if(beg, end, [](float v) { return v != 0.0; });
+    if (beg == end) { break; }
+    auto mid = std::find_if(beg, end, [](float v) { return v == 0.0; });
+    scaled.assign(beg, mid);
+    for (int ind = 0; ind < mid - beg; ++ind) {
+      scaled[ind] *= scale;
+      total_charge += scaled[ind];
+    }
+    rois.add_range(beg - first, scaled.begin(), scaled.end());
+    beg = mid;
+  }
+  return total_charge;
+}
+
+static double sparsified(const float* first, const float* end, double scale, ROIs& rois)
+{
+  double total_charge = 0;
+  sparsify::for_each_roi(
+    first, end, sparsify::Policy{}, scale, [&](const float* rbeg, const float* rend) {
+      for (const float* ptr = rbeg; ptr != rend; ++ptr) {
+        total_charge += float(*ptr * scale);
+      }
+      rois.add_range(rbeg - first,
+                     sparsify::ScaledIterator(rbeg, scale),
+                     sparsify::ScaledIterator(rend, scale));
+    });
+  return total_charge;
+}
+
+// A deconvolved readout: mostly exact zeros with ROIs of a few tens
+// of ticks, some holding zeros, negative zeros and NaN.
+static std::vector<float> make_readout(size_t nchannels, size_t nticks, std::mt19937& rng)
+{
+  std::vector<float> wave(nchannels * nticks, 0.0f);
+  std::uniform_real_distribution<float> value(-200, 800);
+  std::uniform_int_distribution<size_t> start(0, nticks - 1), length(1, 60), special(0, 200);
+  for (size_t ich = 0; ich < nchannels; ++ich) {
+    float* ch = wave.data() + ich * nticks;
+    for (int iroi = 0; iroi < 20; ++iroi) {
+      const size_t beg = start(rng), end = std::min(nticks, beg + length(rng));
+      for (size_t ind = beg; ind < end; ++ind) {
+        switch (special(rng)) {
+        case 0: ch[ind] = 0.0f; break;
+        case 1: ch[ind] = -0.0f; break;
+        case 2: ch[ind] = std::numeric_limits<float>::quiet_NaN(); break;
+        default: ch[ind] = value(rng);
+        }
+      }
+    }
+  }
+  return wave;
+}
+
+int main(int argc, char* argv[])
+{
+  const size_t nchannels = argc > 1 ? std::atoi(argv[1]) : 15360;
+  const size_t nticks = argc > 2 ? std::atoi(argv[2]) : 6000;
+  const double scale = 1.0 / 0.7;
+
+  std::mt19937 rng(1234);
+  const auto wave = make_readout(nchannels, nticks, rng);
+
+  // Sub-vector lengths and offsets exercise the scalar tails.
+  int nbad = 0;
+  ROIs want, got;
+  for (size_t ich = 0; ich < std::min<size_t>(nchannels, 1000); ++ich) {
+    const float* ch = wave.data() + ich * nticks;
+    const size_t off = ich % 8, len = nticks - off - ich % 13;
+    want.clear();
+    got.clear();
+    const double qwant = reference(ch + off, ch + off + len, scale, want);
+    const double qgot = sparsified(ch + off, ch + off + len, scale, got);
+    const bool same_charge =
+      (std::isnan(qwant) && std::isnan(qgot)) || !std::memcmp(&qwant, &qgot, sizeof(double));
+    if (!(want == got) || !same_charge) {
+      std::printf("channel %zu differs\n", ich);
+      ++nbad;
+    }
+  }
+
+  std::printf("%zu channels x %zu ticks\n", nchannels, nticks);
+  for (int which = 0; which < 2; ++which) {
+    const int npasses = 5;
+    size_t nrois = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < npasses; ++pass) {
+      for (size_t ich = 0; ich < nchannels; ++ich) {
+        const float* ch = wave.data() + ich * nticks;
+        got.clear();
+        if (which) { sparsified(ch, ch + nticks, scale, got); }
+        else {
+          reference(ch, ch + nticks, scale, got);
+        }
+        nrois += got.offsets.size();
+      }
+    }
+    std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+    std::printf("%-10s %8.2f ms/pass %8zu ROIs/pass\n",
+                which ? "sparsify" : "find_if", 1e3 * dt.count() / npasses, nrois / npasses);
+  }
+  if (nbad) { std::printf("%d mismatches\n", nbad); }
+  return nbad ? 1 : 0;
+}
@@ -0,0 +1,93 @@
+#!/bin/bash
+#
+# Compare the cost of wclsRawFrameSource variants from the stage
+# timing table which WCLS prints at the end of the job.
+#
+#   compare_stage_timing.sh [-n nevents] [-l label] input.root [compressed.root]
+#
+# The input holds raw::RawDigits of the given art label ("daq" by
+# default).  Each variant runs art on it with stage_timing and the
+# mean and p90 of each stage plus the peak RSS of the job (if GNU
+# time is found) are tabulated.  Logs and frame files are left in
+# the working directory.
+#
+# Variants:
+#   eager  convert all ADCs to float as the event is read
+#   lazy   convert each trace on its first read
+#
+# If a second file holding the same events with compressed (eg
+# raw::kHuffman) RawDigits is given, the variants are repeated on it
+# as zeager and zlazy.  These decode straight into the trace buffers
+# and compare with the uncompressed input which a separate uncompress
+# step would have made.
+
+set -e
+
+mydir="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+export FHICL_FILE_PATH="$mydir/fcl:$FHICL_FILE_PATH"
+export WIRECELL_PATH="$mydir/cfg:$WIRECELL_PATH"
+
+nevents=-1
+label=daq
+while getopts "n:l:" opt ; do
+    case $opt in
+        n) nevents=$OPTARG ;;
+        l) label=$OPTARG ;;
+        *) echo "usage: $0 [-n nevents] [-l label] input.root [compressed.root]" 1>&2 ; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+input="$1"
+compressed="$2"
+if [[ -z "$input" ]] ; then
+    echo "usage: $0 [-n nevents] [-l label] input.root [compressed.root]" 1>&2
+    exit 1
+fi
+
+timer=""
+if /usr/bin/time -v true >/dev/null 2>&1 ; then
+    timer="/usr/bin/time -v"
+fi
+
+# Run one variant given its name, input and lazy setting.
+function run_variant () {
+    local name="$1" input="$2" lazy="$3"
+    cat > "timing-$name.fcl" <<EOF2
+#include "rawframesource_timing.fcl"
+physics.producers.wcls.wcls_main.params.raw_input_label: "$label"
+physics.producers.wcls.wcls_main.params.outname: "frames-$name.tar"
+physics.producers.wcls.wcls_main.structs.lazy: $lazy
+EOF2
+    echo "running $name" 1>&2
+    $timer art -n "$nevents" -c "timing-$name.fcl" -s "$input" > "timing-$name.log" 2>&1
+}
+
+# Print one row per stage and measure of the stage timing table of a
+# log, prefixed by the variant name.
+function stage_rows () {
+    local name="$1"
+    awk -v name="$name" '
+        /^WCLS: stage timing/ { intable = 1; next }
+        intable && $1 == "stage" { next }
+        intable && NF == 7 { printf "%-10s %-32s %-9s %10s %10s\n", name, $1, $2, $3, $5 ; next }
+        intable { intable = 0 }
+    ' "timing-$name.log"
+    local peak=$(awk '/Maximum resident set size/ { print $NF / 1024 }' "timing-$name.log")
+    if [[ -n "$peak" ]] ; then
+        printf "%-10s %-32s %-9s %10.1f %10s\n" "$name" "job" "peak[MB]" "$peak" ""
+    fi
+}
+
+variants=(eager lazy)
+run_variant eager "$input" false
+run_variant lazy "$input" true
+if [[ -n "$compressed" ]] ; then
+    variants+=(zeager zlazy)
+    run_variant zeager "$compressed" false
+    run_variant zlazy "$compressed" true
+fi
+
+printf "%-10s %-32s %-9s %10s %10s\n" variant stage measure mean p90
+for name in "${variants[@]}" ; do
+    stage_rows "$name"
+done | sort -s -b -k2,2 -k3,3
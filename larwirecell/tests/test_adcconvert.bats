@@ -0,0 +1,24 @@
+#!/usr/bin/env bats
+
+function cd_tmp () {
+    if [[ -n "$WCT_BATS_TMPDIR" ]] ; then
+        mkdir -p "$WCT_BATS_TMPDIR"
+        cd "$WCT_BATS_TMPDIR"
+        return
+    fi
+    cd "$BATS_TEST_TMPDIR"
+}
+
+@test "ADC conversion kernels match a plain loop" {
+    local mydir="$(dirname "$BATS_TEST_FILENAME")"
+    cd_tmp
+
+    run ${CXX:-c++} -O2 -std=c++17 -I $mydir/../Components \
+        -o adcconvert $mydir/bench/adcconvert.cxx
+    echo "$output"
+    [[ "$status" -eq 0 ]]
+
+    run ./adcconvert
+    echo "$output" 1>&3
+    [[ "$status" -eq 0 ]]
+}
@@ -0,0 +1,63 @@
+#!/usr/bin/env bats
+
+# Save simulated raw digits through wclsFrameSaver whole and as
+# overlapping time slices split by anode and stitched back, then
+# compare.  The simulation reuses the depofluxwriter configuration.
+
+function cd_tmp () {
+    if [[ -n "$WCT_BATS_TMPDIR" ]] ; then
+        mkdir -p "$WCT_BATS_TMPDIR"
+        cd "$WCT_BATS_TMPDIR"
+        return
+    fi
+    cd "$BATS_TEST_TMPDIR"
+}
+
+setup_file () {
+    local mydir="$(dirname "$BATS_TEST_FILENAME")"
+    local name="$(basename "$BATS_TEST_FILENAME" .bats)"
+
+    export FHICL_FILE_PATH="$mydir/framesaver/fcl:$mydir/depofluxwriter/fcl:$FHICL_FILE_PATH"
+    export WIRECELL_PATH="$mydir/framesaver/cfg:$mydir/depofluxwriter/cfg:$WIRECELL_PATH"
+
+    cd_tmp
+
+    local gen="${name}_gen.root"
+    if [[ -f "$gen" ]] ; then
+        echo "Existing artroot file: $gen" 1>&3
+    else
+        echo art -n 1 -o "$gen" -c prodsingle_sim_dunefd.fcl 1>&3
+        art -n 1 -o "$gen" -c prodsingle_sim_dunefd.fcl
+    fi
+
+    local out="${name}_artroot.root"
+    if [[ -f "$out" ]] ; then
+        echo "Existing artroot file: $out" 1>&3
+    else
+        echo art -n 1 -c "${name}.fcl" -s "$gen" 1>&3
+        art -n 1 -c "${name}.fcl" -s "$gen"
+    fi
+}
+
+# Run a comparison of compare.C and require it to find no failures.
+function compare () {
+    local mydir="$(dirname "$BATS_TEST_FILENAME")"
+    local data="test_framesaver_stitch_artroot.root"
+    cd_tmp
+    run root -b -q $mydir/framesaver/root/compare.C'("'"$data"'","'"$1"'")'
+    echo "$output"
+    [[ -z "$(echo "$output" | grep '^FAIL')" ]]
+    [[ -n "$(echo "$output" | grep "^$1: 0 failures")" ]]
+}
+
+@test "Stitched raw digits match whole" {
+    compare adc
+}
+
+@test "Stitched exact ROIs match whole" {
+    compare exact
+}
+
+@test "Threshold ROIs follow the policy" {
+    compare thresh
+}